@@ -0,0 +1,25 @@
+#include "buffer_squash.h"
+
+namespace cycamore {
+
+int SquashRuns(cyclus::toolkit::ResBuf<cyclus::Material>& buf) {
+  if (buf.count() < 2) {
+    return 0;
+  }
+
+  cyclus::toolkit::MatVec mats = buf.PopN(buf.count());
+  cyclus::toolkit::MatVec runs;
+  runs.push_back(mats[0]);
+  for (int i = 1; i < mats.size(); ++i) {
+    cyclus::Material::Ptr last = runs.back();
+    if (mats[i]->comp()->id() == last->comp()->id()) {
+      last->Absorb(mats[i]);
+    } else {
+      runs.push_back(mats[i]);
+    }
+  }
+  buf.Push(runs);
+  return mats.size() - runs.size();
+}
+
+}  // namespace cycamore
@@ -0,0 +1,20 @@
+#ifndef CYCAMORE_SRC_BUFFER_SQUASH_H_
+#define CYCAMORE_SRC_BUFFER_SQUASH_H_
+
+#include "cyclus.h"
+
+namespace cycamore {
+
+/// Merges each run of adjacent materials with the same composition in buf
+/// into the first material of the run, so a buffer filled lot by lot with
+/// the same stream holds one material per run instead of one per lot.  The
+/// merge goes through Material::Absorb, so every lot stays a parent of the
+/// merged material.  Runs are never reordered, so popping any quantity from
+/// the front of the buffer yields the same compositions as before.  This is
+/// only meant for buffers that are drawn from by quantity, where the lot
+/// boundaries carry no meaning.  Returns the number of materials absorbed.
+int SquashRuns(cyclus::toolkit::ResBuf<cyclus::Material>& buf);
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_BUFFER_SQUASH_H_
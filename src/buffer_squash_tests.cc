@@ -0,0 +1,49 @@
+#include "buffer_squash.h"
+
+#include <gtest/gtest.h>
+#include "cyclus.h"
+
+using cyclus::Composition;
+using cyclus::Material;
+
+namespace {
+
+Composition::Ptr Comp(int nuc) {
+  cyclus::CompMap m;
+  m[nuc] = 1;
+  return Composition::CreateFromMass(m);
+}
+
+}  // namespace
+
+namespace cycamore {
+
+TEST(BufferSquashTests, AdjacentRuns) {
+  Composition::Ptr a = Comp(922350000);
+  Composition::Ptr b = Comp(922380000);
+
+  cyclus::toolkit::ResBuf<Material> buf;
+  buf.Push(Material::CreateUntracked(1, a));
+  buf.Push(Material::CreateUntracked(2, a));
+  buf.Push(Material::CreateUntracked(3, b));
+  buf.Push(Material::CreateUntracked(4, a));
+
+  // the later run of a is kept behind b
+  EXPECT_EQ(1, SquashRuns(buf));
+  ASSERT_EQ(3, buf.count());
+  EXPECT_DOUBLE_EQ(10, buf.quantity());
+
+  Material::Ptr m = buf.Pop();
+  EXPECT_DOUBLE_EQ(3, m->quantity());
+  EXPECT_EQ(a, m->comp());
+  m = buf.Pop();
+  EXPECT_DOUBLE_EQ(3, m->quantity());
+  EXPECT_EQ(b, m->comp());
+  m = buf.Pop();
+  EXPECT_DOUBLE_EQ(4, m->quantity());
+  EXPECT_EQ(a, m->comp());
+
+  EXPECT_EQ(0, SquashRuns(buf));
+}
+
+}  // namespace cycamore
@@ -0,0 +1,82 @@
+#include "comp_vec.h"
+
+#include <algorithm>
+
+namespace cycamore {
+
+double Dot(const double* a, const double* b, int n) {
+  double sum = 0;
+  for (int i = 0; i < n; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+CompVec::CompVec(cyclus::Composition::Ptr c) : molar_mass_(0) {
+  const cyclus::CompMap& atom = c->atom();
+  const cyclus::CompMap& mass = c->mass();
+
+  int n = atom.size();
+  nucs_.reserve(n);
+  atom_.reserve(n);
+  mass_.reserve(n);
+  amass_.reserve(n);
+
+  // atom and mass maps share the same keys and both iterate in nuclide order
+  double atom_tot = 0;
+  double mass_tot = 0;
+  cyclus::CompMap::const_iterator ita = atom.begin();
+  cyclus::CompMap::const_iterator itm = mass.begin();
+  for (; ita != atom.end() && itm != mass.end(); ++ita, ++itm) {
+    nucs_.push_back(ita->first);
+    atom_.push_back(ita->second);
+    mass_.push_back(itm->second);
+    amass_.push_back(pyne::atomic_mass(ita->first));
+    atom_tot += ita->second;
+    mass_tot += itm->second;
+  }
+
+  n = nucs_.size();
+  for (int i = 0; i < n; ++i) {
+    if (atom_tot > 0) {
+      atom_[i] /= atom_tot;
+    }
+    if (mass_tot > 0) {
+      mass_[i] /= mass_tot;
+    }
+  }
+
+  if (n > 0) {
+    molar_mass_ = Dot(&atom_[0], &amass_[0], n);
+  }
+}
+
+int CompVec::Find(int nuc) const {
+  std::vector<int>::const_iterator it =
+      std::lower_bound(nucs_.begin(), nucs_.end(), nuc);
+  if (it == nucs_.end() || *it != nuc) {
+    return -1;
+  }
+  return it - nucs_.begin();
+}
+
+double CompVec::AtomFrac(int nuc) const {
+  int i = Find(nuc);
+  return i < 0 ? 0 : atom_[i];
+}
+
+double CompVec::MassFrac(int nuc) const {
+  int i = Find(nuc);
+  return i < 0 ? 0 : mass_[i];
+}
+
+double CompVec::UraniumAssayMass() const {
+  double u235 = MassFrac(922350000);
+  double u238 = MassFrac(922380000);
+  if (u235 + u238 <= 0) {
+    return 0;
+  }
+  return u235 / (u235 + u238);
+}
+
+}  // namespace cycamore
@@ -0,0 +1,67 @@
+#ifndef CYCAMORE_SRC_COMP_VEC_H_
+#define CYCAMORE_SRC_COMP_VEC_H_
+
+#include <vector>
+
+#include "cyclus.h"
+
+namespace cycamore {
+
+/// Returns the sum of the element-wise products of the first n values of a
+/// and b.  This is the inner kernel used for all composition reductions (molar
+/// mass, weighted sums, etc.) so that they run over contiguous arrays instead
+/// of map nodes.
+double Dot(const double* a, const double* b, int n);
+
+/// CompVec is a flattened, read-only view of a cyclus composition.  The
+/// nuclide ids, normalized atom fractions, normalized mass fractions and the
+/// atomic mass of each nuclide are stored in parallel contiguous arrays that
+/// are sorted by nuclide id.  Building one costs a single pass over the
+/// composition's maps; afterwards per-nuclide lookups are binary searches and
+/// reductions are tight loops over the arrays.  Agents that do repeated
+/// composition math on the same material (fuel blending, enrichment assay
+/// calculations, separations) should build a CompVec once and reuse it rather
+/// than going through MatQuery or copying and renormalizing CompMaps.
+class CompVec {
+ public:
+  explicit CompVec(cyclus::Composition::Ptr c);
+
+  /// Returns the number of nuclides in the composition.
+  int size() const { return nucs_.size(); }
+
+  /// Returns the sorted nuclide ids.
+  const std::vector<int>& nucs() const { return nucs_; }
+
+  /// Returns the normalized atom fractions in nuclide order.
+  const std::vector<double>& atom() const { return atom_; }
+
+  /// Returns the normalized mass fractions in nuclide order.
+  const std::vector<double>& mass() const { return mass_; }
+
+  /// Returns the index of nuc in the arrays or -1 if it is not present.
+  int Find(int nuc) const;
+
+  /// Returns the atom fraction of nuc (zero if not present).
+  double AtomFrac(int nuc) const;
+
+  /// Returns the mass fraction of nuc (zero if not present).
+  double MassFrac(int nuc) const;
+
+  /// Returns the average molar mass (g/mol) of the composition.
+  double MolarMass() const { return molar_mass_; }
+
+  /// Returns the U-235 mass fraction of the uranium in the composition
+  /// (U-235 / (U-235 + U-238)) or zero if there is no uranium.
+  double UraniumAssayMass() const;
+
+ private:
+  std::vector<int> nucs_;
+  std::vector<double> atom_;
+  std::vector<double> mass_;
+  std::vector<double> amass_;
+  double molar_mass_;
+};
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_COMP_VEC_H_
@@ -0,0 +1,58 @@
+#include "comp_vec.h"
+
+#include <gtest/gtest.h>
+#include "cyclus.h"
+
+using pyne::nucname::id;
+using cyclus::Composition;
+using cyclus::CompMap;
+using cyclus::Material;
+using cyclus::toolkit::MatQuery;
+
+namespace cycamore {
+
+TEST(CompVecTests, Dot) {
+  double a[] = {1, 2, 3};
+  double b[] = {4, 5, 6};
+  EXPECT_DOUBLE_EQ(32, Dot(a, b, 3));
+  EXPECT_DOUBLE_EQ(0, Dot(a, b, 0));
+}
+
+TEST(CompVecTests, MatchesMatQuery) {
+  CompMap m;
+  m[id("u235")] = 7;
+  m[id("u238")] = 993;
+  m[id("pu239")] = 30;
+  Composition::Ptr c = Composition::CreateFromMass(m);
+  Material::Ptr mat = Material::CreateUntracked(1, c);
+  MatQuery mq(mat);
+  CompVec v(c);
+
+  ASSERT_EQ(3, v.size());
+  EXPECT_TRUE(v.nucs()[0] < v.nucs()[1] && v.nucs()[1] < v.nucs()[2]);
+  EXPECT_EQ(-1, v.Find(id("am241")));
+  EXPECT_DOUBLE_EQ(0, v.AtomFrac(id("am241")));
+  EXPECT_DOUBLE_EQ(0, v.MassFrac(id("am241")));
+
+  const char* nucs[] = {"u235", "u238", "pu239"};
+  double molar = 0;
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_NEAR(mq.atom_frac(id(nucs[i])), v.AtomFrac(id(nucs[i])), 1e-14);
+    EXPECT_NEAR(mq.mass_frac(id(nucs[i])), v.MassFrac(id(nucs[i])), 1e-14);
+    molar += v.AtomFrac(id(nucs[i])) * pyne::atomic_mass(id(nucs[i]));
+  }
+  EXPECT_DOUBLE_EQ(molar, v.MolarMass());
+  EXPECT_NEAR(cyclus::toolkit::UraniumAssayMass(mat), v.UraniumAssayMass(),
+              1e-14);
+}
+
+TEST(CompVecTests, NoUranium) {
+  CompMap m;
+  m[id("pu239")] = 1;
+  CompVec v(Composition::CreateFromAtom(m));
+  EXPECT_DOUBLE_EQ(0, v.UraniumAssayMass());
+  EXPECT_DOUBLE_EQ(1, v.AtomFrac(id("pu239")));
+  EXPECT_DOUBLE_EQ(pyne::atomic_mass(id("pu239")), v.MolarMass());
+}
+
+}  // namespace cycamore
@@ -0,0 +1,121 @@
+#include "compact_output.h"
+
+namespace cycamore {
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+CompactOutput::Mode CompactOutput::ParseMode(const std::string& s) {
+  if (s.empty() || s == "off") {
+    return OFF;
+  } else if (s == "batches") {
+    return BATCHES;
+  } else if (s == "runs") {
+    return RUNS;
+  }
+  throw cyclus::ValueError("unknown compact output mode '" + s +
+                           "', expected '', 'off', 'batches' or 'runs'");
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void CompactOutput::RecordPosition(cyclus::Agent* agent, double latitude,
+                                   double longitude, const std::string& mode) {
+  if (ParseMode(mode) != OFF) {
+    agent->context()
+        ->NewDatum("AgentPositionCompact")
+        ->AddVal("AgentId", agent->id())
+        ->AddVal("Latitude", latitude)
+        ->AddVal("Longitude", longitude)
+        ->Record();
+    return;
+  }
+
+  agent->context()
+      ->NewDatum("AgentPosition")
+      ->AddVal("Spec", agent->spec())
+      ->AddVal("Prototype", agent->prototype())
+      ->AddVal("AgentId", agent->id())
+      ->AddVal("Latitude", latitude)
+      ->AddVal("Longitude", longitude)
+      ->Record();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+SeriesBuffer::SeriesBuffer(cyclus::Agent* agent, const std::string& name,
+                           const std::string& mode, int batch_size)
+    : agent_(agent),
+      name_(name),
+      mode_(&mode),
+      batch_size_(batch_size),
+      described_(false),
+      start_(0),
+      run_len_(0),
+      run_value_(0) {}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool SeriesBuffer::Record(double value) {
+  CompactOutput::Mode mode = CompactOutput::ParseMode(*mode_);
+  if (mode == CompactOutput::OFF) {
+    return false;
+  }
+
+  cyclus::Context* ctx = agent_->context();
+  bool runs = mode == CompactOutput::RUNS;
+  if (!described_) {
+    ctx->NewDatum("TimeSeriesEncodings")
+        ->AddVal("AgentId", agent_->id())
+        ->AddVal("Series", name_)
+        ->AddVal("Encoding", std::string(runs ? "runs" : "batches"))
+        ->AddVal("Table", std::string(runs ? "TimeSeriesRuns" :
+                                      "TimeSeriesBatches"))
+        ->Record();
+    described_ = true;
+  }
+
+  // a batch or run only holds consecutive time steps
+  int t = ctx->time();
+  if (size() > 0 &&
+      (t != start_ + size() || (runs && value != run_value_))) {
+    Flush();
+  }
+  if (size() == 0) {
+    start_ = t;
+  }
+  if (runs) {
+    run_value_ = value;
+    run_len_++;
+  } else {
+    values_.push_back(value);
+  }
+
+  if (values_.size() >= batch_size_ || t >= ctx->sim_info().duration - 1) {
+    Flush();
+  }
+  return true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void SeriesBuffer::Flush() {
+  if (run_len_ > 0) {
+    agent_->context()
+        ->NewDatum("TimeSeriesRuns")
+        ->AddVal("AgentId", agent_->id())
+        ->AddVal("Series", name_)
+        ->AddVal("StartTime", start_)
+        ->AddVal("NSteps", run_len_)
+        ->AddVal("Value", run_value_)
+        ->Record();
+    run_len_ = 0;
+  }
+  if (!values_.empty()) {
+    agent_->context()
+        ->NewDatum("TimeSeriesBatches")
+        ->AddVal("AgentId", agent_->id())
+        ->AddVal("Series", name_)
+        ->AddVal("StartTime", start_)
+        ->AddVal("NSteps", static_cast<int>(values_.size()))
+        ->AddVal("Values", values_)
+        ->Record();
+    values_.clear();
+  }
+}
+
+}  // namespace cycamore
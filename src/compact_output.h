@@ -0,0 +1,100 @@
+#ifndef CYCAMORE_SRC_COMPACT_OUTPUT_H_
+#define CYCAMORE_SRC_COMPACT_OUTPUT_H_
+
+#include <string>
+#include <vector>
+
+#include "cyclus.h"
+
+namespace cycamore {
+
+/// CompactOutput switches the cycamore position and time series tables to
+/// compact schemas.
+///
+/// Compact output is chosen per agent by the owner's compact_output state
+/// variable, so it is part of the simulation input.  Its value names the
+/// mode: empty (the default) or "off" keeps the regular tables, "batches"
+/// and "runs" turn compact output on with that time series encoding.  When
+/// it is on:
+///
+///  * the position goes to the AgentPositionCompact table (AgentId,
+///    Latitude, Longitude) instead of AgentPosition.  The spec and prototype
+///    strings are not repeated; they are found by joining on AgentId with the
+///    AgentEntry table, which cyclus writes for every agent anyway.
+///
+///  * time series recorded through a SeriesBuffer are encoded per series
+///    instead of one TimeSeries<name> row per step.  With the BATCHES
+///    encoding they go to TimeSeriesBatches, with one row per batch of
+///    consecutive steps.  With the RUNS encoding only changes are kept.  They
+///    go to TimeSeriesRuns, with one row per run of steps that share a
+///    value.  Steady facilities then write a handful of rows over a whole
+///    simulation.
+///
+/// Every compact series also writes one TimeSeriesEncodings row (AgentId,
+/// Series, Encoding, Table) when its first value is recorded.  Runs expand
+/// back to one value per step at Time = StartTime + i for 0 <= i < NSteps.
+/// Batches expand the same way, with Values[i] as the value.
+class CompactOutput {
+ public:
+  /// The compact output modes.
+  enum Mode {
+    OFF = 0,
+    BATCHES,
+    RUNS
+  };
+
+  /// Returns the mode named by s.  Throws a cyclus::ValueError if s names
+  /// none.
+  static Mode ParseMode(const std::string& s);
+
+  /// Records the agent's geographical position to AgentPosition or, if mode
+  /// turns compact output on, to AgentPositionCompact.
+  static void RecordPosition(cyclus::Agent* agent, double latitude,
+                             double longitude, const std::string& mode);
+};
+
+/// SeriesBuffer collects one time series of one agent in memory and writes
+/// it in the compact encoding when the agent's mode turns compact output on.  Each
+/// TimeSeriesBatches row holds the AgentId, the series name, the first time
+/// step of the batch and the values of the consecutive steps that follow; a
+/// batch is written once it holds batch_size values.  Each TimeSeriesRuns row
+/// holds the AgentId, the series name, the first time step of the run, its
+/// length and its value; a run is written when the value changes.  Either is
+/// also written on the last time step of the simulation or when the owner
+/// calls Flush (e.g. on decommissioning).
+///
+/// When compact output is off Record returns false and the caller writes the
+/// value with the usual cyclus::toolkit::RecordTimeSeries, so the regular
+/// TimeSeries tables and their listeners are unchanged for that agent.
+class SeriesBuffer {
+ public:
+  /// Buffers the series name of agent in the compact mode named by mode,
+  /// which is usually one of the agent's state variables.
+  SeriesBuffer(cyclus::Agent* agent, const std::string& name,
+               const std::string& mode, int batch_size = 120);
+
+  /// Buffers value for the current time step.  Returns false without
+  /// buffering anything if compact output is off.
+  bool Record(double value);
+
+  /// Writes any buffered values as one batch or run.
+  void Flush();
+
+  /// Returns the number of buffered time steps.
+  int size() const { return run_len_ + values_.size(); }
+
+ private:
+  cyclus::Agent* agent_;
+  std::string name_;
+  const std::string* mode_;
+  int batch_size_;
+  bool described_;
+  int start_;
+  std::vector<double> values_;
+  int run_len_;
+  double run_value_;
+};
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_COMPACT_OUTPUT_H_
@@ -0,0 +1,132 @@
+#include "compact_output.h"
+
+#include <gtest/gtest.h>
+#include "cyclus.h"
+
+using cyclus::Cond;
+using cyclus::QueryResult;
+
+namespace {
+
+cyclus::Composition::Ptr NatU() {
+  cyclus::CompMap m;
+  m[922350000] = 0.007;
+  m[922380000] = 0.993;
+  return cyclus::Composition::CreateFromMass(m);
+}
+
+}  // namespace
+
+namespace cycamore {
+
+TEST(CompactOutputTests, Position) {
+  std::string config =
+      "<in_commods><val>commod</val></in_commods>"
+      "<latitude>2.0</latitude>"
+      "<longitude>-20.0</longitude>"
+      "<compact_output>batches</compact_output>";
+
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Sink"), config, 1);
+  int id = sim.Run();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  QueryResult qr = sim.db().Query("AgentPositionCompact", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_DOUBLE_EQ(2.0, qr.GetVal<double>("Latitude"));
+  EXPECT_DOUBLE_EQ(-20.0, qr.GetVal<double>("Longitude"));
+}
+
+TEST(CompactOutputTests, ParseMode) {
+  EXPECT_EQ(CompactOutput::OFF, CompactOutput::ParseMode(""));
+  EXPECT_EQ(CompactOutput::OFF, CompactOutput::ParseMode("off"));
+  EXPECT_EQ(CompactOutput::BATCHES, CompactOutput::ParseMode("batches"));
+  EXPECT_EQ(CompactOutput::RUNS, CompactOutput::ParseMode("runs"));
+  EXPECT_THROW(CompactOutput::ParseMode("rle"), cyclus::ValueError);
+}
+
+TEST(CompactOutputTests, PerAgent) {
+  // the compact table replaces the regular one
+  std::string config =
+      "<in_commods><val>commod</val></in_commods>"
+      "<compact_output>batches</compact_output>";
+
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Sink"), config, 1);
+  sim.AddSource("commod").Finalize();
+  int id = sim.Run();
+
+  QueryResult qr = sim.db().Query("AgentPositionCompact", NULL);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(id, qr.GetVal<int>("AgentId"));
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  EXPECT_THROW(sim.db().Query("AgentPosition", &conds), std::exception);
+}
+
+TEST(CompactOutputTests, SeriesBatches) {
+  std::string config =
+      "<feed_commod>natu</feed_commod>"
+      "<feed_recipe>natu1</feed_recipe>"
+      "<product_commod>enr_u</product_commod>"
+      "<tails_commod>tails</tails_commod>"
+      "<tails_assay>0.003</tails_assay>"
+      "<compact_output>batches</compact_output>";
+
+  int simdur = 4;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Enrichment"), config,
+                      simdur);
+  sim.AddRecipe("natu1", NatU());
+  int id = sim.Run();
+
+  // one batch per series covering the whole (short) simulation
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  conds.push_back(Cond("Series", "==", std::string("EnrichmentSWU")));
+  QueryResult qr = sim.db().Query("TimeSeriesBatches", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(0, qr.GetVal<int>("StartTime"));
+  EXPECT_EQ(simdur, qr.GetVal<int>("NSteps"));
+  std::vector<double> vals = qr.GetVal<std::vector<double> >("Values");
+  ASSERT_EQ(simdur, vals.size());
+  for (int i = 0; i < simdur; ++i) {
+    EXPECT_DOUBLE_EQ(0, vals[i]);
+  }
+
+  conds[1] = Cond("Series", "==", std::string("EnrichmentFeed"));
+  qr = sim.db().Query("TimeSeriesBatches", &conds);
+  EXPECT_EQ(1, qr.rows.size());
+}
+
+TEST(CompactOutputTests, SeriesRuns) {
+  std::string config =
+      "<feed_commod>natu</feed_commod>"
+      "<feed_recipe>natu1</feed_recipe>"
+      "<product_commod>enr_u</product_commod>"
+      "<tails_commod>tails</tails_commod>"
+      "<tails_assay>0.003</tails_assay>"
+      "<compact_output>runs</compact_output>";
+
+  int simdur = 6;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Enrichment"), config,
+                      simdur);
+  sim.AddRecipe("natu1", NatU());
+  int id = sim.Run();
+
+  // nothing is enriched, so the whole series is a single run of zeros
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  conds.push_back(Cond("Series", "==", std::string("EnrichmentSWU")));
+  QueryResult qr = sim.db().Query("TimeSeriesRuns", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(0, qr.GetVal<int>("StartTime"));
+  EXPECT_EQ(simdur, qr.GetVal<int>("NSteps"));
+  EXPECT_DOUBLE_EQ(0, qr.GetVal<double>("Value"));
+
+  qr = sim.db().Query("TimeSeriesEncodings", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ("runs", qr.GetVal<std::string>("Encoding"));
+  EXPECT_EQ("TimeSeriesRuns", qr.GetVal<std::string>("Table"));
+}
+
+}  // namespace cycamore
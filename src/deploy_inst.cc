@@ -1,49 +1,80 @@
 // Implements the DeployInst class
 #include "deploy_inst.h"
 
+#include "compact_output.h"
+
 namespace cycamore {
 
 DeployInst::DeployInst(cyclus::Context* ctx)
     : cyclus::Institution(ctx),
       latitude(0.0),
       longitude(0.0),
+      compact_output(""),
       coordinates(latitude, longitude) {}
 
 DeployInst::~DeployInst() {}
 
 void DeployInst::Build(cyclus::Agent* parent) {
   cyclus::Institution::Build(parent);
-  BuildSched::iterator it;
-  std::set<std::string> protos;
+  DeploySched sched = CompileSched();
+  DeploySched::iterator it;
+  std::vector<std::pair<std::string, int> >::iterator pit;
+  for (it = sched.begin(); it != sched.end(); ++it) {
+    for (pit = it->second.begin(); pit != it->second.end(); ++pit) {
+      for (int j = 0; j < pit->second; j++) {
+        context()->SchedBuild(this, pit->first, it->first);
+      }
+    }
+  }
+}
+
+DeploySched DeployInst::CompileSched() {
+  // resolved prototype names by (prototype, lifetime)
+  std::map<std::pair<std::string, int>, std::string> names;
+  DeploySched sched;
+  bool custom_life = lifetimes.size() == prototypes.size();
   for (int i = 0; i < prototypes.size(); i++) {
     std::string proto = prototypes[i];
+    if (custom_life) {
+      std::pair<std::string, int> key(proto, lifetimes[i]);
+      std::map<std::pair<std::string, int>, std::string>::iterator it =
+          names.find(key);
+      if (it == names.end()) {
+        cyclus::Agent* a = context()->CreateAgent<Agent>(proto);
+        if (a->lifetime() != lifetimes[i]) {
+          a->lifetime(lifetimes[i]);
 
-    std::stringstream ss;
-    ss << proto;
-
-    if (lifetimes.size() == prototypes.size()) {
-      cyclus::Agent* a = context()->CreateAgent<Agent>(proto);
-      if (a->lifetime() != lifetimes[i]) {
-        a->lifetime(lifetimes[i]);
-
-        if (lifetimes[i] == -1) {
-          ss << "_life_forever";
+          std::stringstream ss;
+          ss << proto;
+          if (lifetimes[i] == -1) {
+            ss << "_life_forever";
+          } else {
+            ss << "_life_" << lifetimes[i];
+          }
+          context()->AddPrototype(ss.str(), a);
+          names[key] = ss.str();
         } else {
-          ss << "_life_" << lifetimes[i];
-        }
-        proto = ss.str();
-        if (protos.count(proto) == 0) {
-          protos.insert(proto);
-          context()->AddPrototype(proto, a);
+          names[key] = proto;
         }
+        it = names.find(key);
       }
+      proto = it->second;
     }
 
-    int t = build_times[i];
-    for (int j = 0; j < n_build[i]; j++) {
-      context()->SchedBuild(this, proto, t);
+    if (n_build[i] > 0) {
+      std::vector<std::pair<std::string, int> >& builds =
+          sched[build_times[i]];
+      int j = 0;
+      while (j < builds.size() && builds[j].first != proto) {
+        j++;
+      }
+      if (j == builds.size()) {
+        builds.push_back(std::make_pair(proto, 0));
+      }
+      builds[j].second += n_build[i];
     }
   }
+  return sched;
 }
 
 void DeployInst::EnterNotify() {
@@ -69,15 +100,8 @@ void DeployInst::EnterNotify() {
 }
 
 void DeployInst::RecordPosition() {
-  std::string specification = this->spec();
-  context()
-      ->NewDatum("AgentPosition")
-      ->AddVal("Spec", specification)
-      ->AddVal("Prototype", this->prototype())
-      ->AddVal("AgentId", id())
-      ->AddVal("Latitude", latitude)
-      ->AddVal("Longitude", longitude)
-      ->Record();
+  CompactOutput::RecordPosition(this, latitude, longitude,
+                                 compact_output);
 }
 
 extern "C" cyclus::Agent* ConstructDeployInst(cyclus::Context* ctx) {
@@ -4,6 +4,8 @@
 #include <utility>
 #include <set>
 #include <map>
+#include <string>
+#include <vector>
 
 #include "cyclus.h"
 #include "cycamore_version.h"
@@ -12,6 +14,12 @@ namespace cycamore {
 
 typedef std::map<int, std::vector<std::string> > BuildSched;
 
+/// A compiled deployment schedule: the number of agents to build of each
+/// (lifetime-specific) prototype name, by build time.  The prototypes of a
+/// time step are kept in the order they first appear in the input.
+typedef std::map<int, std::vector<std::pair<std::string, int> > >
+    DeploySched;
+
 // Builds and manages agents (facilities) according to a manually specified
 // deployment schedule. Deployed agents are automatically decommissioned at
 // the end of their lifetime.  The user specifies a list of prototypes for
@@ -45,6 +53,12 @@ class DeployInst : public cyclus::Institution,
 
   virtual void EnterNotify();
 
+  /// Compiles the deployment table into a time-sorted schedule.  Rows that
+  /// share a build time and prototype (including lifetime) are merged into
+  /// one count, and a lifetime-specific prototype is created and registered
+  /// only once per (prototype, lifetime) pair.
+  DeploySched CompileSched();
+
  protected:
   #pragma cyclus var { \
     "doc": "Ordered list of prototypes to build.", \
@@ -100,6 +114,16 @@ class DeployInst : public cyclus::Institution,
   }
   double longitude;
 
+  #pragma cyclus var { \
+    "default": "", \
+    "uilabel": "Compact Output Mode", \
+    "userlevel": 10, \
+    "doc": "Output mode for this agent's position. Empty or 'off' " \
+           "writes the regular tables. 'batches' writes the position to " \
+           "AgentPositionCompact, as does 'runs'.", \
+  }
+  std::string compact_output;
+
   cyclus::toolkit::Position coordinates;
 
   /// Records an agent's latitude and longitude to the output db
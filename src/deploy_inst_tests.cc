@@ -1,3 +1,5 @@
+#include <sstream>
+
 #include <gtest/gtest.h>
 
 #include "context.h"
@@ -141,6 +143,57 @@ TEST(DeployInstTests, NoDupProtos) {
   EXPECT_EQ(1, stmt->GetInt(0));
 }
 
+// rows may be given in any time order and rows sharing a build time and
+// prototype are merged
+TEST(DeployInstTests, MergedSchedule) {
+  std::string config =
+     "<prototypes>  <val>foobar</val> <val>foobar</val> <val>foobar</val> <val>foobar</val> </prototypes>"
+     "<build_times> <val>3</val>      <val>1</val>      <val>3</val>      <val>2</val>      </build_times>"
+     "<n_build>     <val>2</val>      <val>1</val>      <val>4</val>      <val>0</val>      </n_build>"
+     ;
+
+  int simdur = 5;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:DeployInst"), config, simdur);
+  sim.DummyProto("foobar");
+  int id = sim.Run();
+
+  int counts[] = {0, 1, 0, 6};
+  for (int t = 1; t < 4; t++) {
+    std::stringstream ss;
+    ss << "SELECT COUNT(*) FROM AgentEntry WHERE Prototype = 'foobar' AND EnterTime = " << t << ";";
+    cyclus::SqlStatement::Ptr stmt = sim.db().db().Prepare(ss.str());
+    stmt->Step();
+    EXPECT_EQ(counts[t], stmt->GetInt(0)) << "at time " << t;
+  }
+}
+
+TEST(DeployInstTests, ScheduleOrder) {
+  // builds of one time step keep the order of their first input row
+  std::string config =
+     "<prototypes>  <val>foo</val> <val>bar</val> <val>foo</val> </prototypes>"
+     "<build_times> <val>1</val>   <val>1</val>   <val>1</val>   </build_times>"
+     "<n_build>     <val>1</val>   <val>1</val>   <val>1</val>   </n_build>"
+     ;
+
+  int simdur = 3;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:DeployInst"), config, simdur);
+  sim.DummyProto("foo");
+  sim.DummyProto("bar");
+  int id = sim.Run();
+
+  cyclus::SqlStatement::Ptr stmt = sim.db().db().Prepare(
+      "SELECT Prototype FROM AgentEntry WHERE EnterTime = 1 "
+      "ORDER BY AgentId;");
+  std::vector<std::string> protos;
+  while (stmt->Step()) {
+    protos.push_back(stmt->GetText(0, NULL));
+  }
+  ASSERT_EQ(3, protos.size());
+  EXPECT_EQ("foo", protos[0]);
+  EXPECT_EQ("foo", protos[1]);
+  EXPECT_EQ("bar", protos[2]);
+}
+
 TEST(DeployInstTests, PositionInitialize) {
   std::string config = 
      "<prototypes>  <val>foobar</val> </prototypes>"
@@ -9,6 +9,10 @@
 
 #include <boost/lexical_cast.hpp>
 
+#include "comp_vec.h"
+#include "memory_report.h"
+#include "trade_withdrawal.h"
+
 namespace cycamore {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -23,9 +27,24 @@ Enrichment::Enrichment(cyclus::Context* ctx)
       product_commod(""),
       tails_commod(""),
       order_prefs(true),
+      tails_bidding("discrete"),
+      tails_bin_width(0.0005),
+      min_request_qty(0),
+      request_resume_qty(0),
+      batch_trades(false),
+      trade_records(false),
+      feed_u235_(0),
+      feed_u238_(0),
+      feed_qty_(0),
       latitude(0.0),
       longitude(0.0),
-      coordinates(latitude, longitude) {}
+      compact_output(""),
+      profile_phases(false),
+      memory_report_period(0),
+      coordinates(latitude, longitude),
+      profile_(this, profile_phases),
+      swu_series_(this, "EnrichmentSWU", compact_output),
+      feed_series_(this, "EnrichmentFeed", compact_output) {}
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Enrichment::~Enrichment() {}
@@ -47,9 +66,22 @@ void Enrichment::Build(cyclus::Agent* parent) {
   using cyclus::Material;
 
   Facility::Build(parent);
+  if (tails_bidding != "discrete" && tails_bidding != "binned" &&
+      tails_bidding != "squashed") {
+    throw cyclus::ValueError(Agent::InformErrorMsg(
+        "tails_bidding must be one of 'discrete', 'binned' or 'squashed', "
+        "got '" + tails_bidding + "'"));
+  }
+  if (tails_bidding == "binned" && tails_bin_width <= 0) {
+    throw cyclus::ValueError(
+        Agent::InformErrorMsg("tails_bin_width must be positive"));
+  }
+
   if (initial_feed > 0) {
-    inventory.Push(Material::Create(this, initial_feed,
-                                    context()->GetRecipe(feed_recipe)));
+    Material::Ptr feed = Material::Create(this, initial_feed,
+                                          context()->GetRecipe(feed_recipe));
+    inventory.Push(feed);
+    TallyFeed_(feed, 1);
   }
 
   LOG(cyclus::LEV_DEBUG2, "EnrFac") << "Enrichment "
@@ -59,22 +91,44 @@ void Enrichment::Build(cyclus::Agent* parent) {
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-void Enrichment::Tick() { current_swu_capacity = SwuCapacity(); }
+void Enrichment::Tick() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::TICK);
+  current_swu_capacity = SwuCapacity();
+}
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Enrichment::Tock() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::TOCK);
+  offer_pool_.Reset();
   using cyclus::toolkit::RecordTimeSeries;
   LOG(cyclus::LEV_INFO4, "EnrFac") << prototype() << " used "
                                    << intra_timestep_swu_ << " SWU";
-  RecordTimeSeries<cyclus::toolkit::ENRICH_SWU>(this, intra_timestep_swu_);
+  if (!swu_series_.Record(intra_timestep_swu_)) {
+    RecordTimeSeries<cyclus::toolkit::ENRICH_SWU>(this, intra_timestep_swu_);
+  }
   LOG(cyclus::LEV_INFO4, "EnrFac") << prototype() << " used "
                                    << intra_timestep_feed_ << " feed";
-  RecordTimeSeries<cyclus::toolkit::ENRICH_FEED>(this, intra_timestep_feed_);
+  if (!feed_series_.Record(intra_timestep_feed_)) {
+    RecordTimeSeries<cyclus::toolkit::ENRICH_FEED>(this, intra_timestep_feed_);
+  }
+  if (MemoryReport::Due(context(), memory_report_period)) {
+    MemoryReport::Record(this, "inventory", inventory);
+    MemoryReport::Record(this, "tails", tails);
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Enrichment::Decommission() {
+  profile_.Flush();
+  swu_series_.Flush();
+  feed_series_.Flush();
+  cyclus::Facility::Decommission();
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr>
 Enrichment::GetMatlRequests() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_REQUESTS);
   using cyclus::Material;
   using cyclus::RequestPortfolio;
   using cyclus::Request;
@@ -83,32 +137,41 @@ Enrichment::GetMatlRequests() {
   RequestPortfolio<Material>::Ptr port(new RequestPortfolio<Material>());
   Material::Ptr mat = Request_();
   double amt = mat->quantity();
+  bool open = req_gate_.Open(amt, min_request_qty, request_resume_qty);
 
-  if (amt > cyclus::eps_rsrc()) {
+  if (amt > cyclus::eps_rsrc() && open) {
     port->AddRequest(mat, this, feed_commod);
     ports.insert(port);
   }
 
+  profile_.Count(ports);
   return ports;
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
-bool SortBids(cyclus::Bid<cyclus::Material>* i,
-              cyclus::Bid<cyclus::Material>* j) {
-  cyclus::Material::Ptr mat_i = i->offer();
-  cyclus::Material::Ptr mat_j = j->offer();
+namespace {
+
+// Bid decorated with the U-235 mass fraction of its offer, used to sort bids
+// without re-querying offer compositions on every comparison.
+struct U235Key {
+  double frac;
+  // true if the offer carries no U-235 mass at all
+  bool zero;
+  cyclus::Bid<cyclus::Material>* bid;
+};
+
+bool SortU235Keys(const U235Key& i, const U235Key& j) {
+  return i.frac < j.frac;
+}
 
-  cyclus::toolkit::MatQuery mq_i(mat_i);
-  cyclus::toolkit::MatQuery mq_j(mat_j);
+}  // namespace
 
-  return ((mq_i.mass(922350000) / mq_i.qty()) <=
-          (mq_j.mass(922350000) / mq_j.qty()));
-}
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 // Sort offers of input material to have higher preference for more
 //  U-235 content
 void Enrichment::AdjustMatlPrefs(
     cyclus::PrefMap<cyclus::Material>::type& prefs) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::ADJUST_MATL_PREFS);
   using cyclus::Bid;
   using cyclus::Material;
   using cyclus::Request;
@@ -117,36 +180,47 @@ void Enrichment::AdjustMatlPrefs(
     return;
   }
 
+  // U-235 mass fraction per offer composition, shared by all requests since
+  // suppliers typically offer the same few compositions to every request
+  std::map<int, double> fracs;
+
   cyclus::PrefMap<cyclus::Material>::type::iterator reqit;
 
   // Loop over all requests
   for (reqit = prefs.begin(); reqit != prefs.end(); ++reqit) {
-    std::vector<Bid<Material>*> bids_vector;
+    std::vector<U235Key> keys;
+    keys.reserve(reqit->second.size());
     std::map<Bid<Material>*, double>::iterator mit;
     for (mit = reqit->second.begin(); mit != reqit->second.end(); ++mit) {
       Bid<Material>* bid = mit->first;
-      bids_vector.push_back(bid);
+      Material::Ptr offer = bid->offer();
+      int comp_id = offer->comp()->id();
+      std::map<int, double>::iterator found = fracs.find(comp_id);
+      if (found == fracs.end()) {
+        double frac = CompVec(offer->comp()).MassFrac(922350000);
+        found = fracs.insert(std::make_pair(comp_id, frac)).first;
+      }
+      U235Key key;
+      key.frac = found->second;
+      key.zero = found->second * offer->quantity() == 0;
+      key.bid = bid;
+      keys.push_back(key);
     }
-    std::sort(bids_vector.begin(), bids_vector.end(), SortBids);
-
-    // Assign preferences to the sorted vector
-    double n_bids = bids_vector.size();
-    bool u235_mass = 0;
+    std::stable_sort(keys.begin(), keys.end(), SortU235Keys);
 
-    for (int bidit = 0; bidit < bids_vector.size(); bidit++) {
-      int new_pref = bidit + 1;
-
-      // For any bids with U-235 qty=0, set pref to zero.
+    // Assign preferences to the sorted vector.  For any leading bids with
+    // U-235 qty=0, set pref to zero.
+    bool u235_mass = false;
+    for (int i = 0; i < keys.size(); i++) {
+      int new_pref = i + 1;
       if (!u235_mass) {
-        cyclus::Material::Ptr mat = bids_vector[bidit]->offer();
-        cyclus::toolkit::MatQuery mq(mat);
-        if (mq.mass(922350000) == 0) {
+        if (keys[i].zero) {
           new_pref = -1;
         } else {
           u235_mass = true;
         }
       }
-      (reqit->second)[bids_vector[bidit]] = new_pref;
+      (reqit->second)[keys[i].bid] = new_pref;
     }  // each bid
   }    // each Material Request
 }
@@ -155,6 +229,7 @@ void Enrichment::AdjustMatlPrefs(
 void Enrichment::AcceptMatlTrades(
     const std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                                 cyclus::Material::Ptr> >& responses) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::ACCEPT_MATL_TRADES);
   // see
   // http://stackoverflow.com/questions/5181183/boostshared-ptr-and-inheritance
   std::vector<std::pair<cyclus::Trade<cyclus::Material>,
@@ -167,6 +242,7 @@ void Enrichment::AcceptMatlTrades(
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> Enrichment::GetMatlBids(
     cyclus::CommodMap<cyclus::Material>::type& out_requests) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_BIDS);
   using cyclus::Bid;
   using cyclus::BidPortfolio;
   using cyclus::CapacityConstraint;
@@ -182,12 +258,16 @@ std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> Enrichment::GetMatlBids(
 
     std::vector<Request<Material>*>& tails_requests =
         out_requests[tails_commod];
+    // offer bids for all tails material, keeping discrete quantities
+    // to preserve possible variation in composition unless aggregate
+    // bidding was requested
+    MatVec mats = tails.PopN(tails.count());
+    tails.Push(mats);
+    if (tails_bidding != "discrete") {
+      mats = AggregateTails_(mats);
+    }
     std::vector<Request<Material>*>::iterator it;
     for (it = tails_requests.begin(); it != tails_requests.end(); ++it) {
-      // offer bids for all tails material, keeping discrete quantities
-      // to preserve possible variation in composition
-      MatVec mats = tails.PopN(tails.count());
-      tails.Push(mats);
       for (int k = 0; k < mats.size(); k++) {
         Material::Ptr m = mats[k];
         Request<Material>* req = *it;
@@ -213,7 +293,7 @@ std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> Enrichment::GetMatlBids(
     for (it = commod_requests.begin(); it != commod_requests.end(); ++it) {
       Request<Material>* req = *it;
       Material::Ptr mat = req->target();
-      double request_enrich = cyclus::toolkit::UraniumAssayMass(mat);
+      double request_enrich = CompVec(mat->comp()).UraniumAssayMass();
       if (ValidReq(req->target()) &&
           ((request_enrich < max_enrich) ||
            (cyclus::AlmostEq(request_enrich, max_enrich)))) {
@@ -222,8 +302,9 @@ std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> Enrichment::GetMatlBids(
       }
     }
 
-    Converter<Material>::Ptr sc(new SWUConverter(FeedAssay(), tails_assay));
-    Converter<Material>::Ptr nc(new NatUConverter(FeedAssay(), tails_assay));
+    double feed_assay = FeedAssay();
+    Converter<Material>::Ptr sc(new SWUConverter(feed_assay, tails_assay));
+    Converter<Material>::Ptr nc(new NatUConverter(feed_assay, tails_assay));
     CapacityConstraint<Material> swu(swu_capacity, sc);
     CapacityConstraint<Material> natu(inventory.quantity(), nc);
     commod_port->AddConstraint(swu);
@@ -235,14 +316,49 @@ std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> Enrichment::GetMatlBids(
         << prototype() << " adding a natu constraint of " << natu.capacity();
     ports.insert(commod_port);
   }
+  profile_.Count(ports);
   return ports;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+cyclus::toolkit::MatVec Enrichment::AggregateTails_(
+    const cyclus::toolkit::MatVec& mats) {
+  using cyclus::CompMap;
+  using cyclus::Material;
+
+  // bin index -> (total qty, summed mass composition); a single bin when
+  // squashing
+  std::map<int, std::pair<double, CompMap> > bins;
+  for (int i = 0; i < mats.size(); i++) {
+    Material::Ptr m = mats[i];
+    int bin = 0;
+    if (tails_bidding == "binned") {
+      double assay = CompVec(m->comp()).UraniumAssayMass();
+      bin = static_cast<int>(std::floor(assay / tails_bin_width));
+    }
+    CompMap cm = m->comp()->mass();
+    cyclus::compmath::Normalize(&cm, m->quantity());
+    std::pair<double, CompMap>& b = bins[bin];
+    b.first += m->quantity();
+    b.second = cyclus::compmath::Add(b.second, cm);
+  }
+
+  // trades always pop from the front of the tails buffer, so the offers only
+  // need to carry representative compositions and quantities
+  cyclus::toolkit::MatVec offers;
+  std::map<int, std::pair<double, CompMap> >::iterator it;
+  for (it = bins.begin(); it != bins.end(); ++it) {
+    offers.push_back(Material::CreateUntracked(
+        it->second.first, cyclus::Composition::CreateFromMass(it->second.second)));
+  }
+  return offers;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 bool Enrichment::ValidReq(const cyclus::Material::Ptr mat) {
-  cyclus::toolkit::MatQuery q(mat);
-  double u235 = q.atom_frac(922350000);
-  double u238 = q.atom_frac(922380000);
+  CompVec v(mat->comp());
+  double u235 = v.AtomFrac(922350000);
+  double u238 = v.AtomFrac(922380000);
   return (u238 > 0 && u235 / (u235 + u238) > tails_assay);
 }
 
@@ -251,33 +367,50 @@ void Enrichment::GetMatlTrades(
     const std::vector<cyclus::Trade<cyclus::Material> >& trades,
     std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                           cyclus::Material::Ptr> >& responses) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_TRADES);
   using cyclus::Material;
   using cyclus::Trade;
 
   intra_timestep_swu_ = 0;
   intra_timestep_feed_ = 0;
 
-  std::vector<Trade<Material> >::const_iterator it;
-  for (it = trades.begin(); it != trades.end(); ++it) {
-    double qty = it->amt;
-    std::string commod_type = it->bid->request()->commodity();
-    Material::Ptr response;
-
-    // Figure out whether material is tails or enriched,
-    // if tails then make transfer of material
-    if (commod_type == tails_commod) {
+  // the tails trades are resolved together and withdrawn from the tails
+  // buffer before any enrichment adds to it
+  std::vector<Material::Ptr> mats(trades.size());
+  std::vector<int> tails_idx;
+  std::vector<double> tails_qtys;
+  for (int i = 0; i < trades.size(); ++i) {
+    if (trades[i].bid->request()->commodity() == tails_commod) {
       LOG(cyclus::LEV_INFO5, "EnrFac")
           << prototype() << " just received an order"
-          << " for " << it->amt << " of " << tails_commod;
-      double pop_qty = std::min(qty, tails.quantity());
-      response = tails.Pop(pop_qty, cyclus::eps_rsrc());
-    } else {
+          << " for " << trades[i].amt << " of " << tails_commod;
+      tails_idx.push_back(i);
+      tails_qtys.push_back(trades[i].amt);
+    }
+  }
+  if (!tails_idx.empty()) {
+    cyclus::toolkit::MatVec out = WithdrawTrades(tails, tails_qtys);
+    for (int j = 0; j < tails_idx.size(); ++j) {
+      mats[tails_idx[j]] = out[j];
+    }
+  }
+
+  if (batch_trades) {
+    BatchTrades_(trades, mats);
+  } else {
+    for (int i = 0; i < trades.size(); ++i) {
+      if (mats[i]) {
+        continue;
+      }
       LOG(cyclus::LEV_INFO5, "EnrFac")
           << prototype() << " just received an order"
-          << " for " << it->amt << " of " << product_commod;
-      response = Enrich_(it->bid->offer(), qty);
+          << " for " << trades[i].amt << " of " << product_commod;
+      mats[i] = Enrich_(trades[i].bid->offer(), trades[i].amt);
     }
-    responses.push_back(std::make_pair(*it, response));
+  }
+
+  for (int i = 0; i < trades.size(); ++i) {
+    responses.push_back(std::make_pair(trades[i], mats[i]));
   }
 
   if (cyclus::IsNegative(tails.quantity())) {
@@ -327,6 +460,7 @@ void Enrichment::AddMat_(cyclus::Material::Ptr mat) {
     e.msg(Agent::InformErrorMsg(e.msg()));
     throw e;
   }
+  TallyFeed_(mat, 1);
 
   LOG(cyclus::LEV_INFO5, "EnrFac")
       << prototype() << " added " << mat->quantity() << " of " << feed_commod
@@ -343,12 +477,20 @@ cyclus::Material::Ptr Enrichment::Request_() {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 cyclus::Material::Ptr Enrichment::Offer_(cyclus::Material::Ptr mat) {
-  cyclus::toolkit::MatQuery q(mat);
+  int key = mat->comp()->id();
+  cyclus::Material::Ptr offer = offer_pool_.Find(key, mat->quantity());
+  if (offer) {
+    return offer;
+  }
+
+  CompVec v(mat->comp());
   cyclus::CompMap comp;
-  comp[922350000] = q.atom_frac(922350000);
-  comp[922380000] = q.atom_frac(922380000);
-  return cyclus::Material::CreateUntracked(
+  comp[922350000] = v.AtomFrac(922350000);
+  comp[922380000] = v.AtomFrac(922380000);
+  offer = cyclus::Material::CreateUntracked(
       mat->quantity(), cyclus::Composition::CreateFromAtom(comp));
+  offer_pool_.Put(key, mat->quantity(), offer);
+  return offer;
 }
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 cyclus::Material::Ptr Enrichment::Enrich_(cyclus::Material::Ptr mat,
@@ -368,15 +510,7 @@ cyclus::Material::Ptr Enrichment::Enrich_(cyclus::Material::Ptr mat,
 
   // Determine the composition of the natural uranium
   // (ie. U-235+U-238/TotalMass)
-  double pop_qty = inventory.quantity();
-  Material::Ptr natu_matl = inventory.Pop(pop_qty, cyclus::eps_rsrc());
-  inventory.Push(natu_matl);
-
-  cyclus::toolkit::MatQuery mq(natu_matl);
-  std::set<cyclus::Nuc> nucs;
-  nucs.insert(922350000);
-  nucs.insert(922380000);
-  double natu_frac = mq.mass_frac(nucs);
+  double natu_frac = NatUFrac_();
   double feed_req = natu_req / natu_frac;
 
   // pop amount from inventory and blob it into one material
@@ -389,6 +523,7 @@ cyclus::Material::Ptr Enrichment::Enrich_(cyclus::Material::Ptr mat,
       r = inventory.Pop(feed_req, cyclus::eps_rsrc());
     }
   } catch (cyclus::Error& e) {
+    SyncFeedTally_();
     NatUConverter nc(FeedAssay(), tails_assay);
     std::stringstream ss;
     ss << " tried to remove " << feed_req << " from its inventory of size "
@@ -400,6 +535,7 @@ cyclus::Material::Ptr Enrichment::Enrich_(cyclus::Material::Ptr mat,
 
   // "enrich" it, but pull out the composition and quantity we require from the
   // blob
+  TallyFeed_(r, -1);
   cyclus::Composition::Ptr comp = mat->comp();
   Material::Ptr response = r->ExtractComp(qty, comp);
   tails.Push(r);
@@ -429,6 +565,88 @@ cyclus::Material::Ptr Enrichment::Enrich_(cyclus::Material::Ptr mat,
   return response;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Enrichment::BatchTrades_(
+    const std::vector<cyclus::Trade<cyclus::Material> >& trades,
+    std::vector<cyclus::Material::Ptr>& mats) {
+  using cyclus::Material;
+  using cyclus::toolkit::UraniumAssayMass;
+  using cyclus::toolkit::ValueFunc;
+
+  // the feed and tails assays are shared by every trade, so only the product
+  // assay varies across the pass
+  double xf = FeedAssay();
+  double xt = tails_assay;
+  double vf = ValueFunc(xf);
+  double vt = ValueFunc(xt);
+  double natu_frac = NatUFrac_();
+
+  std::vector<int> prod;
+  std::vector<double> feed_reqs;
+  std::vector<double> swu_reqs;
+  double feed_tot = 0;
+  double swu_tot = 0;
+  for (int i = 0; i < trades.size(); ++i) {
+    if (trades[i].bid->request()->commodity() == tails_commod) {
+      continue;
+    }
+    double qty = trades[i].amt;
+    double xp = UraniumAssayMass(trades[i].bid->offer());
+    double natu_req = qty * (xp - xt) / (xf - xt);
+    double tails_qty = qty * (xp - xf) / (xf - xt);
+    double swu_req = qty * ValueFunc(xp) + tails_qty * vt - natu_req * vf;
+    double feed_req = natu_req / natu_frac;
+
+    prod.push_back(i);
+    feed_reqs.push_back(feed_req);
+    swu_reqs.push_back(swu_req);
+    feed_tot += feed_req;
+    swu_tot += swu_req;
+  }
+
+  // withdraw the feed for all product trades at once
+  Material::Ptr r;
+  if (!prod.empty()) {
+    try {
+      if (cyclus::AlmostEq(feed_tot, inventory.quantity())) {
+        r = cyclus::toolkit::Squash(inventory.PopN(inventory.count()));
+      } else {
+        r = inventory.Pop(feed_tot, cyclus::eps_rsrc());
+      }
+    } catch (cyclus::Error& e) {
+      SyncFeedTally_();
+      std::stringstream ss;
+      ss << " tried to remove " << feed_tot << " from its inventory of size "
+         << inventory.quantity() << " for " << prod.size() << " trades";
+      throw cyclus::ValueError(Agent::InformErrorMsg(ss.str()));
+    }
+    TallyFeed_(r, -1);
+  }
+
+  for (int j = 0; j < prod.size(); ++j) {
+    const cyclus::Trade<Material>& trade = trades[prod[j]];
+    mats[prod[j]] = r->ExtractComp(trade.amt, trade.bid->offer()->comp());
+    if (trade_records) {
+      RecordEnrichment_(feed_reqs[j], swu_reqs[j]);
+    }
+  }
+
+  if (r) {
+    tails.Push(r);
+    current_swu_capacity -= swu_tot;
+    intra_timestep_swu_ += swu_tot;
+    intra_timestep_feed_ += feed_tot;
+    if (!trade_records) {
+      RecordEnrichment_(feed_tot, swu_tot);
+    }
+  }
+
+  LOG(cyclus::LEV_INFO5, "EnrFac") << prototype() << " enriched "
+                                   << prod.size() << " trades using "
+                                   << feed_tot << " kg of feed and "
+                                   << swu_tot << " SWU";
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Enrichment::RecordEnrichment_(double natural_u, double swu) {
   using cyclus::Context;
@@ -449,29 +667,60 @@ void Enrichment::RecordEnrichment_(double natural_u, double swu) {
 }
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 double Enrichment::FeedAssay() {
-  using cyclus::Material;
+  SyncFeedTally_();
+  if (inventory.empty() || feed_u235_ + feed_u238_ <= 0) {
+    return 0;
+  }
+  return feed_u235_ / (feed_u235_ + feed_u238_);
+}
 
-  if (inventory.empty()) {
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double Enrichment::NatUFrac_() {
+  SyncFeedTally_();
+  if (inventory.empty() || feed_qty_ <= 0) {
     return 0;
   }
-  double pop_qty = inventory.quantity();
-  cyclus::Material::Ptr fission_matl =
-      inventory.Pop(pop_qty, cyclus::eps_rsrc());
-  inventory.Push(fission_matl);
-  return cyclus::toolkit::UraniumAssayMass(fission_matl);
+  return (feed_u235_ + feed_u238_) / feed_qty_;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Enrichment::TallyFeed_(cyclus::Material::Ptr mat, double sign) {
+  CompVec v(mat->comp());
+  double qty = sign * mat->quantity();
+  feed_u235_ += qty * v.MassFrac(922350000);
+  feed_u238_ += qty * v.MassFrac(922380000);
+  feed_qty_ += qty;
+  if (inventory.empty()) {
+    // don't let round-off accumulate across refills
+    feed_u235_ = 0;
+    feed_u238_ = 0;
+    feed_qty_ = 0;
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Enrichment::SyncFeedTally_() {
+  if (std::abs(feed_qty_ - inventory.quantity()) <= cyclus::eps_rsrc()) {
+    return;
+  }
+
+  feed_u235_ = 0;
+  feed_u238_ = 0;
+  feed_qty_ = 0;
+  if (inventory.empty()) {
+    return;
+  }
+  cyclus::toolkit::MatVec mats = inventory.PopN(inventory.count());
+  inventory.Push(mats);
+  for (int i = 0; i < mats.size(); i++) {
+    TallyFeed_(mats[i], 1);
+  }
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Enrichment::RecordPosition() {
-  std::string specification = this->spec();
-  context()
-      ->NewDatum("AgentPosition")
-      ->AddVal("Spec", specification)
-      ->AddVal("Prototype", this->prototype())
-      ->AddVal("AgentId", id())
-      ->AddVal("Latitude", latitude)
-      ->AddVal("Longitude", longitude)
-      ->Record();
+  CompactOutput::RecordPosition(this, latitude, longitude,
+                                 compact_output);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -5,6 +5,10 @@
 
 #include "cyclus.h"
 #include "cycamore_version.h"
+#include "compact_output.h"
+#include "material_pool.h"
+#include "phase_profile.h"
+#include "request_gate.h"
 
 namespace cycamore {
 
@@ -186,6 +190,9 @@ class Enrichment
   ///  @param time is the time to perform the tock
   virtual void Tock();
 
+  /// Writes any buffered time series values before decommissioning.
+  virtual void Decommission();
+
   /// @brief The Enrichment request Materials of its given
   /// commodity.
   virtual std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr>
@@ -261,12 +268,38 @@ class Enrichment
 
   cyclus::Material::Ptr Enrich_(cyclus::Material::Ptr mat, double qty);
 
+  ///  @brief responds to all trades of a time step at once: the SWU and feed
+  ///  of every product trade are computed in one pass, the feed is popped
+  ///  from the inventory once and a single Enrichments row is recorded
+  ///  (one per product trade if trade_records is set).  The products are
+  ///  stored in mats at their trades' index; tails trades are left alone.
+  void BatchTrades_(
+      const std::vector<cyclus::Trade<cyclus::Material> >& trades,
+      std::vector<cyclus::Material::Ptr>& mats);
+
   ///  @brief calculates the feed assay based on the unenriched inventory
   double FeedAssay();
 
+  ///  @brief returns the U-235 plus U-238 mass fraction of the unenriched
+  ///  inventory
+  double NatUFrac_();
+
+  ///  @brief adds (sign = 1) or removes (sign = -1) mat's uranium and total
+  ///  mass to or from the running feed inventory tally
+  void TallyFeed_(cyclus::Material::Ptr mat, double sign);
+
+  ///  @brief recomputes the feed inventory tally from the inventory if it has
+  ///  been changed without going through TallyFeed_ (e.g. on restart)
+  void SyncFeedTally_();
+
   ///  @brief records and enrichment with the cyclus::Recorder
   void RecordEnrichment_(double natural_u, double swu);
 
+  ///  @brief combines tails materials into untracked aggregate offers
+  ///  according to tails_bidding - one per U-235 assay bin or a single one
+  ///  for the whole inventory.
+  cyclus::toolkit::MatVec AggregateTails_(const cyclus::toolkit::MatVec& mats);
+
   /// Records an agent's latitude and longitude to the output db
   void RecordPosition();
 
@@ -311,6 +344,31 @@ class Enrichment
   }
   double tails_assay;
 
+  #pragma cyclus var { \
+    "default": "discrete", \
+    "tooltip": "how tails inventory is bid", \
+    "uilabel": "Tails Bidding Mode", \
+    "userlevel": 10, \
+    "doc": "How the tails inventory is offered to tails requests. " \
+           "'discrete' bids every tails material separately, preserving its " \
+           "composition. 'binned' bids one aggregate offer per U-235 assay " \
+           "bin of width tails_bin_width. 'squashed' bids the whole tails " \
+           "inventory as a single offer. The aggregate modes keep the " \
+           "number of tails arcs small when tails accumulate over long " \
+           "simulations." \
+  }
+  std::string tails_bidding;
+
+  #pragma cyclus var { \
+    "default": 0.0005, \
+    "tooltip": "tails assay bin width", \
+    "uilabel": "Tails Assay Bin Width", \
+    "userlevel": 10, \
+    "doc": "Width (U-235 mass fraction of uranium) of the assay bins tails " \
+           "are aggregated into when tails_bidding is 'binned'." \
+  }
+  double tails_bin_width;
+
   #pragma cyclus var {							\
     "default": 0, "tooltip": "initial uranium reserves (kg)",		\
     "uilabel": "Initial Feed Inventory",				\
@@ -368,8 +426,58 @@ class Enrichment
   }
   double swu_capacity;
 
+  #pragma cyclus var { \
+    "default": 0.0, \
+    "userlevel": 10, \
+    "tooltip": "minimum feed request (kg)", \
+    "uilabel": "Minimum Feed Request", \
+    "uitype": "range", \
+    "range": [0.0, 1e299], \
+    "doc": "feed is not requested while the feed inventory has room for " \
+           "less than this quantity (kg)" \
+  }
+  double min_request_qty;
+
+  #pragma cyclus var { \
+    "default": 0.0, \
+    "userlevel": 10, \
+    "tooltip": "feed request resume quantity (kg)", \
+    "uilabel": "Feed Request Resume Quantity", \
+    "uitype": "range", \
+    "range": [0.0, 1e299], \
+    "doc": "once feed requests have stopped, they resume when the feed " \
+           "inventory has room for this quantity (kg); values below " \
+           "min_request_qty resume at min_request_qty" \
+  }
+  double request_resume_qty;
+
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "tooltip": "enrich all trades of a time step at once", \
+    "uilabel": "Batch Trades", \
+    "doc": "if true, the feed for all product trades of a time step is " \
+           "withdrawn from the inventory in one go and the enrichment is " \
+           "recorded as one aggregate Enrichments row per time step. " \
+           "Otherwise each trade is enriched and recorded on its own." \
+  }
+  bool batch_trades;
+
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "tooltip": "record each batched trade", \
+    "uilabel": "Per Trade Records", \
+    "doc": "with batch_trades, record one Enrichments row per product " \
+           "trade instead of a single aggregate row" \
+  }
+  bool trade_records;
+
   double current_swu_capacity;
 
+  // suppresses feed requests below min_request_qty
+  RequestGate req_gate_;
+
   #pragma cyclus var { 'capacity': 'max_feed_inventory' }
   cyclus::toolkit::ResBuf<cyclus::Material> inventory;  // natural u
   #pragma cyclus var {}
@@ -380,7 +488,14 @@ class Enrichment
   double intra_timestep_swu_;
   double intra_timestep_feed_;
 
+  // running U-235, U-238 and total mass of the feed inventory - no need to
+  // persist, SyncFeedTally_ rebuilds them from the inventory when needed.
+  double feed_u235_;
+  double feed_u238_;
+  double feed_qty_;
+
   friend class EnrichmentTest;
+  friend class EnrichmentBench;
   // ---
 
   #pragma cyclus var { \
@@ -399,7 +514,53 @@ class Enrichment
   }
   double longitude;
 
+  #pragma cyclus var { \
+    "default": "", \
+    "uilabel": "Compact Output Mode", \
+    "userlevel": 10, \
+    "doc": "Output mode for this agent's position and SWU and feed time series. " \
+           "Empty or 'off' writes the regular tables. 'batches' writes the " \
+           "position to AgentPositionCompact and the time series to " \
+           "TimeSeriesBatches, one row per batch of steps. 'runs' writes " \
+           "the position the same way and the time series to " \
+           "TimeSeriesRuns, one row per run of steps with the same value.", \
+  }
+  std::string compact_output;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Profile Phases", \
+    "userlevel": 10, \
+    "doc": "If true, this facility records its call counts, wall time " \
+           "and bids or requests emitted for each phase of the time step. " \
+           "The whole-simulation totals are written to the AgentPhaseTimes " \
+           "table at the end of the simulation or when the facility is " \
+           "decommissioned.", \
+  }
+  bool profile_phases;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Memory Report Period", \
+    "userlevel": 10, \
+    "units": "time steps", \
+    "doc": "If positive, this facility writes one AgentMemory row per " \
+           "inventory buffer, with its resource and composition counts, " \
+           "quantity and estimated bytes, every memory_report_period time " \
+           "steps and on the last time step. 0 turns the report off.", \
+  }
+  int memory_report_period;
+
   cyclus::toolkit::Position coordinates;
+
+  // product offers of the current time step keyed by request composition
+  MaterialPool offer_pool_;
+
+  PhaseProfile profile_;
+
+  /// ENRICH_SWU and ENRICH_FEED time series values when compact output is on
+  SeriesBuffer swu_series_;
+  SeriesBuffer feed_series_;
 };
 
 }  // namespace cycamore
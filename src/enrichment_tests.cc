@@ -315,6 +315,48 @@ TEST_F(EnrichmentTest, TradeTails) {
     "Not providing the requested quantity" ;
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(EnrichmentTest, SquashedTailsBids) {
+  // with squashed tails bidding the two tails materials from the TailsQty
+  // scenario are offered (and traded) as one
+  std::string config =
+    "   <feed_commod>natu</feed_commod> "
+    "   <feed_recipe>natu1</feed_recipe> "
+    "   <product_commod>enr_u</product_commod> "
+    "   <tails_commod>tails</tails_commod> "
+    "   <tails_assay>0.003</tails_assay> "
+    "   <tails_bidding>squashed</tails_bidding> ";
+
+  int simdur = 3;
+  cyclus::MockSim sim(cyclus::AgentSpec
+		      (":cycamore:Enrichment"), config, simdur);
+  sim.AddRecipe("natu1", c_natu1());
+  sim.AddRecipe("leu", c_leu());
+
+  sim.AddSource("natu")
+    .recipe("natu1")
+    .Finalize();
+  sim.AddSink("enr_u")
+    .recipe("leu")
+    .capacity(0.5)
+    .Finalize();
+  sim.AddSink("enr_u")
+    .recipe("leu")
+    .capacity(0.5)
+    .Finalize();
+  sim.AddSink("tails")
+    .Finalize();
+
+  int id = sim.Run();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("Commodity", "==", std::string("tails")));
+  QueryResult qr = sim.db().Query("Transactions", &conds);
+  EXPECT_EQ(1, qr.rows.size());
+  Material::Ptr m = sim.GetMaterial(qr.GetVal<int>("ResourceId"));
+  EXPECT_NEAR(8.25, m->quantity(), 0.01);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(EnrichmentTest, BidPrefs) {
   // This tests that natu sources are preference-ordered by
@@ -501,6 +543,24 @@ void EnrichmentTest::DoAddMat(cyclus::Material::Ptr mat) {
   src_facility->AddMat_(mat);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double EnrichmentTest::DoFeedAssay() {
+  return src_facility->FeedAssay();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double EnrichmentTest::DoNatUFrac() {
+  return src_facility->NatUFrac_();
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+cyclus::Material::Ptr EnrichmentTest::DoPeekFeed() {
+  cyclus::toolkit::ResBuf<cyclus::Material>& inv = src_facility->inventory;
+  cyclus::Material::Ptr m = inv.Pop(inv.quantity(), cyclus::eps_rsrc());
+  inv.Push(m);
+  return m;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 cyclus::Material::Ptr EnrichmentTest::DoRequest() {
   return src_facility->Request_();
@@ -660,6 +720,49 @@ TEST_F(EnrichmentTest, Enrich) {
   EXPECT_THROW(response = DoEnrich(target, qty), cyclus::Error);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(EnrichmentTest, FeedTally) {
+  // the running feed tally must track a mixed inventory through additions
+  // and enrichments
+  using cyclus::CompMap;
+  using cyclus::Material;
+  using cyclus::Composition;
+  using cyclus::toolkit::MatQuery;
+  using cyclus::toolkit::UraniumAssayMass;
+
+  src_facility->SetMaxInventorySize(10);
+  src_facility->SwuCapacity(1e299);
+  EXPECT_DOUBLE_EQ(0, DoFeedAssay());
+
+  CompMap v;
+  v[922350000] = 0.01;
+  v[922380000] = 0.98;
+  v[10010000] = 0.01;
+  Material::Ptr dirty =
+      Material::CreateUntracked(2, Composition::CreateFromMass(v));
+  DoAddMat(GetMat(2));
+  DoAddMat(dirty);
+
+  double u235 = 2 * feed_assay + 2 * 0.01;
+  double u238 = 2 * (1 - feed_assay) + 2 * 0.98;
+  EXPECT_NEAR(u235 / (u235 + u238), DoFeedAssay(), 1e-12);
+  EXPECT_NEAR((u235 + u238) / 4, DoNatUFrac(), 1e-12);
+
+  // enriching removes feed from the front of the inventory
+  CompMap p;
+  p[922350000] = 0.05;
+  p[922380000] = 0.95;
+  Material::Ptr target =
+      Material::CreateUntracked(1, Composition::CreateFromMass(p));
+  DoEnrich(target, 0.1);
+
+  Material::Ptr feed = DoPeekFeed();
+  MatQuery mq(feed);
+  EXPECT_NEAR(UraniumAssayMass(feed), DoFeedAssay(), 1e-12);
+  EXPECT_NEAR((mq.mass(922350000) + mq.mass(922380000)) / mq.qty(),
+              DoNatUFrac(), 1e-12);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(EnrichmentTest, Response) {
   // this test asks the facility to respond to multiple requests for enriched
@@ -724,6 +827,65 @@ TEST_F(EnrichmentTest, Response) {
   EXPECT_EQ(responses.size(), 2);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(EnrichmentTest, BatchTrades) {
+  // batched trades use the same feed and SWU as enriching each trade on its
+  // own and hand out the requested product
+  using cyclus::Bid;
+  using cyclus::Material;
+  using cyclus::Request;
+  using cyclus::Trade;
+  using cyclus::toolkit::Assays;
+  using cyclus::toolkit::FeedQty;
+  using cyclus::toolkit::SwuRequired;
+
+  std::vector<double> assays;
+  assays.push_back(0.03);
+  assays.push_back(0.05);
+  double qty = 2;
+  double swu_req = 0;
+  double natu_req = 0;
+  std::vector<Request<Material>*> reqs;
+  std::vector<Bid<Material>*> bids;
+  std::vector<Trade<Material> > trades;
+  for (int i = 0; i < assays.size(); ++i) {
+    cyclus::CompMap v;
+    v[922350000] = assays[i];
+    v[922380000] = 1 - assays[i];
+    Material::Ptr target = Material::CreateUntracked(
+        qty, cyclus::Composition::CreateFromMass(v));
+    Assays a(feed_assay, assays[i], tails_assay);
+    swu_req += SwuRequired(qty, a);
+    natu_req += FeedQty(qty, a);
+
+    reqs.push_back(Request<Material>::Create(target, trader, product_commod));
+    bids.push_back(Bid<Material>::Create(reqs.back(), target, src_facility));
+    trades.push_back(Trade<Material>(reqs.back(), bids.back(), qty));
+  }
+
+  src_facility->SetMaxInventorySize(natu_req * 4);
+  src_facility->SwuCapacity(swu_req * 2);
+  DoAddMat(GetMat(natu_req * 2));
+  DoBatchTrades(true);
+
+  std::vector<std::pair<Trade<Material>, Material::Ptr> > responses;
+  src_facility->GetMatlTrades(trades, responses);
+
+  ASSERT_EQ(2, responses.size());
+  for (int i = 0; i < responses.size(); ++i) {
+    EXPECT_NEAR(qty, responses[i].second->quantity(), 1e-10);
+    EXPECT_EQ(bids[i]->offer()->comp(), responses[i].second->comp());
+  }
+  EXPECT_NEAR(swu_req, DoCurrentSwu(), 1e-8);
+  EXPECT_NEAR(natu_req, DoFeedQty(), 1e-8);
+  EXPECT_NEAR(natu_req - 2 * qty, DoTailsQty(), 1e-8);
+
+  for (int i = 0; i < reqs.size(); ++i) {
+    delete bids[i];
+    delete reqs[i];
+  }
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(EnrichmentTest, PositionInitialize) {
   // this tests verifies the initialization of the latitude variable
@@ -37,10 +37,18 @@ class EnrichmentTest : public ::testing::Test {
   /// @param enr the enrichment percent, i.e. for 5 w/o, enr = 0.05
   cyclus::Material::Ptr GetReqMat(double qty, double enr);
   void DoAddMat(cyclus::Material::Ptr mat);
+  double DoFeedAssay();
+  double DoNatUFrac();
+  /// returns the whole feed inventory squashed into one material
+  cyclus::Material::Ptr DoPeekFeed();
   cyclus::Material::Ptr DoRequest();
   cyclus::Material::Ptr DoBid(cyclus::Material::Ptr mat);
   cyclus::Material::Ptr DoOffer(cyclus::Material::Ptr mat);
   cyclus::Material::Ptr DoEnrich(cyclus::Material::Ptr mat, double qty);
+  void DoBatchTrades(bool batch) { src_facility->batch_trades = batch; }
+  double DoFeedQty() { return src_facility->inventory.quantity(); }
+  double DoTailsQty() { return src_facility->tails.quantity(); }
+  double DoCurrentSwu() { return src_facility->current_swu_capacity; }
   /// @param nreqs the total number of requests
   /// @param nvalid the number of requests that are valid
   boost::shared_ptr< cyclus::ExchangeContext<cyclus::Material> >
@@ -1,6 +1,12 @@
 #include "fuel_fab.h"
 
+#include <map>
+#include <mutex>
 #include <sstream>
+#include <utility>
+
+#include "compact_output.h"
+#include "trade_withdrawal.h"
 
 using cyclus::Material;
 using cyclus::Composition;
@@ -12,55 +18,108 @@ using pyne::simple_xs;
 
 namespace cycamore {
 
-class FissConverter : public cyclus::Converter<cyclus::Material> {
+/// FuelBlend holds the fill, fissile and top-up stream compositions available
+/// to a FuelFab on a given time step and computes the mass fraction of each
+/// stream needed to match the weight of a requested composition.  Solutions
+/// are remembered per requested composition so that the bids and all three
+/// inventory constraint converters share a single computation for each
+/// distinct request composition.
+class FuelBlend {
  public:
-  FissConverter(Composition::Ptr c_fill, Composition::Ptr c_fiss,
-                Composition::Ptr c_topup, std::string spectrum)
-      : c_fiss_(c_fiss), c_topup_(c_topup), c_fill_(c_fill), spec_(spectrum) {
-    w_fiss_ = CosiWeight(c_fiss, spectrum);
-    w_fill_ = CosiWeight(c_fill, spectrum);
-    w_topup_ = CosiWeight(c_topup, spectrum);
+  typedef boost::shared_ptr<FuelBlend> Ptr;
+
+  enum Mode {
+    /// the target weight cannot be spanned by the available streams
+    NONE,
+    /// mix the fill and fissile streams
+    FILL_FISS,
+    /// mix the fissile (used as filler) and top-up streams
+    FISS_TOPUP,
+  };
+
+  /// The mass fractions of each stream in a blend matching some target.
+  struct Fracs {
+    Mode mode;
+    double fill;
+    double fiss;
+    double topup;
+  };
+
+  FuelBlend(Composition::Ptr c_fill, double w_fill, Composition::Ptr c_fiss,
+            double w_fiss, Composition::Ptr c_topup, double w_topup,
+            std::string spectrum)
+      : c_fill_(c_fill),
+        c_fiss_(c_fiss),
+        c_topup_(c_topup),
+        w_fill_(w_fill),
+        w_fiss_(w_fiss),
+        w_topup_(w_topup),
+        spec_(spectrum) {}
+
+  /// Returns the stream mass fractions required to match the weight of tgt.
+  const Fracs& Solve(Composition::Ptr tgt) {
+    std::map<int, Fracs>::iterator it = solved_.find(tgt->id());
+    if (it != solved_.end()) {
+      return it->second;
+    }
+
+    double w_tgt = CosiWeight(tgt, spec_);
+    Fracs f;
+    f.mode = NONE;
+    f.fill = 0;
+    f.fiss = 0;
+    f.topup = 0;
+    if (ValidWeights(w_fill_, w_tgt, w_fiss_)) {
+      double fiss_frac = HighFrac(w_fill_, w_tgt, w_fiss_);
+      f.mode = FILL_FISS;
+      f.fiss = AtomToMassFrac(fiss_frac, c_fiss_, c_fill_);
+      f.fill = AtomToMassFrac(1 - fiss_frac, c_fill_, c_fiss_);
+    } else if (ValidWeights(w_fiss_, w_tgt, w_topup_)) {
+      // use fiss inventory as filler, and topup as fissile
+      double topup_frac = HighFrac(w_fiss_, w_tgt, w_topup_);
+      f.mode = FISS_TOPUP;
+      f.topup = AtomToMassFrac(topup_frac, c_topup_, c_fiss_);
+      f.fiss = AtomToMassFrac(1 - topup_frac, c_fiss_, c_topup_);
+    }
+    return solved_[tgt->id()] = f;
   }
 
+ private:
+  Composition::Ptr c_fill_;
+  Composition::Ptr c_fiss_;
+  Composition::Ptr c_topup_;
+  double w_fill_;
+  double w_fiss_;
+  double w_topup_;
+  std::string spec_;
+  std::map<int, Fracs> solved_;
+};
+
+class FissConverter : public cyclus::Converter<cyclus::Material> {
+ public:
+  FissConverter(FuelBlend::Ptr blend) : blend_(blend) {}
+
   virtual ~FissConverter() {}
 
   virtual double convert(
       cyclus::Material::Ptr m, cyclus::Arc const* a = NULL,
       cyclus::ExchangeTranslationContext<cyclus::Material> const* ctx =
           NULL) const {
-    double w_tgt = CosiWeight(m->comp(), spec_);
-    if (ValidWeights(w_fill_, w_tgt, w_fiss_)) {
-      double frac = HighFrac(w_fill_, w_tgt, w_fiss_);
-      return AtomToMassFrac(frac, c_fiss_, c_fill_) * m->quantity();
-    } else if (ValidWeights(w_fiss_, w_tgt, w_topup_)) {
-      // use fiss inventory as filler, and topup as fissile
-      double frac = LowFrac(w_fiss_, w_tgt, w_topup_);
-      return AtomToMassFrac(frac, c_fiss_, c_topup_) * m->quantity();
-    } else {
+    const FuelBlend::Fracs& f = blend_->Solve(m->comp());
+    if (f.mode == FuelBlend::NONE) {
       // don't bid at all
       return 1e200;
     }
+    return f.fiss * m->quantity();
   }
 
  private:
-  std::string spec_;
-  double w_fiss_;
-  double w_topup_;
-  double w_fill_;
-  Composition::Ptr c_fiss_;
-  Composition::Ptr c_fill_;
-  Composition::Ptr c_topup_;
+  FuelBlend::Ptr blend_;
 };
 
 class FillConverter : public cyclus::Converter<cyclus::Material> {
  public:
-  FillConverter(Composition::Ptr c_fill, Composition::Ptr c_fiss,
-                Composition::Ptr c_topup, std::string spectrum)
-      : c_fiss_(c_fiss), c_topup_(c_topup), c_fill_(c_fill), spec_(spectrum) {
-    w_fiss_ = CosiWeight(c_fiss, spectrum);
-    w_fill_ = CosiWeight(c_fill, spectrum);
-    w_topup_ = CosiWeight(c_topup, spectrum);
-  }
+  FillConverter(FuelBlend::Ptr blend) : blend_(blend) {}
 
   virtual ~FillConverter() {}
 
@@ -68,38 +127,22 @@ class FillConverter : public cyclus::Converter<cyclus::Material> {
       cyclus::Material::Ptr m, cyclus::Arc const* a = NULL,
       cyclus::ExchangeTranslationContext<cyclus::Material> const* ctx =
           NULL) const {
-    double w_tgt = CosiWeight(m->comp(), spec_);
-    if (ValidWeights(w_fill_, w_tgt, w_fiss_)) {
-      double frac = LowFrac(w_fill_, w_tgt, w_fiss_);
-      return AtomToMassFrac(frac, c_fill_, c_fiss_) * m->quantity();
-    } else if (ValidWeights(w_fiss_, w_tgt, w_topup_)) {
-      // switched fissile inventory to filler so don't need any filler inventory
-      return 0;
-    } else {
+    const FuelBlend::Fracs& f = blend_->Solve(m->comp());
+    if (f.mode == FuelBlend::NONE) {
       // don't bid at all
       return 1e200;
     }
+    // zero if fissile inventory was switched to filler
+    return f.fill * m->quantity();
   }
 
  private:
-  std::string spec_;
-  double w_fiss_;
-  double w_topup_;
-  double w_fill_;
-  Composition::Ptr c_fiss_;
-  Composition::Ptr c_fill_;
-  Composition::Ptr c_topup_;
+  FuelBlend::Ptr blend_;
 };
 
 class TopupConverter : public cyclus::Converter<cyclus::Material> {
  public:
-  TopupConverter(Composition::Ptr c_fill, Composition::Ptr c_fiss,
-                 Composition::Ptr c_topup, std::string spectrum)
-      : c_fiss_(c_fiss), c_topup_(c_topup), c_fill_(c_fill), spec_(spectrum) {
-    w_fiss_ = CosiWeight(c_fiss, spectrum);
-    w_fill_ = CosiWeight(c_fill, spectrum);
-    w_topup_ = CosiWeight(c_topup, spectrum);
-  }
+  TopupConverter(FuelBlend::Ptr blend) : blend_(blend) {}
 
   virtual ~TopupConverter() {}
 
@@ -107,27 +150,17 @@ class TopupConverter : public cyclus::Converter<cyclus::Material> {
       cyclus::Material::Ptr m, cyclus::Arc const* a = NULL,
       cyclus::ExchangeTranslationContext<cyclus::Material> const* ctx =
           NULL) const {
-    double w_tgt = CosiWeight(m->comp(), spec_);
-    if (ValidWeights(w_fill_, w_tgt, w_fiss_)) {
-      return 0;
-    } else if (ValidWeights(w_fiss_, w_tgt, w_topup_)) {
-      // switched fissile inventory to filler and topup as fissile
-      double frac = HighFrac(w_fiss_, w_tgt, w_topup_);
-      return AtomToMassFrac(frac, c_topup_, c_fiss_) * m->quantity();
-    } else {
+    const FuelBlend::Fracs& f = blend_->Solve(m->comp());
+    if (f.mode == FuelBlend::NONE) {
       // don't bid at all
       return 1e200;
     }
+    // zero unless fissile inventory was switched to filler
+    return f.topup * m->quantity();
   }
 
  private:
-  std::string spec_;
-  double w_fiss_;
-  double w_topup_;
-  double w_fill_;
-  Composition::Ptr c_fiss_;
-  Composition::Ptr c_fill_;
-  Composition::Ptr c_topup_;
+  FuelBlend::Ptr blend_;
 };
 
 FuelFab::FuelFab(cyclus::Context* ctx)
@@ -137,7 +170,10 @@ FuelFab::FuelFab(cyclus::Context* ctx)
       throughput(0),
       latitude(0.0),
       longitude(0.0),
-      coordinates(latitude, longitude) {}
+      compact_output(""),
+      profile_phases(false),
+      coordinates(latitude, longitude),
+      profile_(this, profile_phases) {}
 
 void FuelFab::EnterNotify() {
   cyclus::Facility::EnterNotify();
@@ -167,6 +203,7 @@ void FuelFab::EnterNotify() {
 }
 
 std::set<cyclus::RequestPortfolio<Material>::Ptr> FuelFab::GetMatlRequests() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_REQUESTS);
   using cyclus::RequestPortfolio;
 
   std::set<RequestPortfolio<Material>::Ptr> ports;
@@ -227,6 +264,7 @@ std::set<cyclus::RequestPortfolio<Material>::Ptr> FuelFab::GetMatlRequests() {
     ports.insert(port);
   }
 
+  profile_.Count(ports);
   return ports;
 }
 
@@ -242,6 +280,7 @@ bool Contains(std::vector<std::string> vec, std::string s) {
 void FuelFab::AcceptMatlTrades(
     const std::vector<std::pair<cyclus::Trade<Material>, Material::Ptr> >&
         responses) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::ACCEPT_MATL_TRADES);
   std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                         cyclus::Material::Ptr> >::const_iterator trade;
 
@@ -278,6 +317,7 @@ void FuelFab::AcceptMatlTrades(
 
 std::set<cyclus::BidPortfolio<Material>::Ptr> FuelFab::GetMatlBids(
     cyclus::CommodMap<Material>::type& commod_requests) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_BIDS);
   using cyclus::BidPortfolio;
 
   std::set<BidPortfolio<Material>::Ptr> ports;
@@ -321,36 +361,37 @@ std::set<cyclus::BidPortfolio<Material>::Ptr> FuelFab::GetMatlBids(
     w_fiss = CosiWeight(c_fiss, spectrum);
   }
 
+  FuelBlend::Ptr blend(new FuelBlend(c_fill, w_fill, c_fiss, w_fiss, c_topup,
+                                     w_topup, spectrum));
+
   BidPortfolio<Material>::Ptr port(new BidPortfolio<Material>());
   for (int j = 0; j < reqs.size(); j++) {
     cyclus::Request<Material>* req = reqs[j];
 
-    Composition::Ptr tgt = req->target()->comp();
-    double w_tgt = CosiWeight(tgt, spectrum);
+    const FuelBlend::Fracs& f = blend->Solve(req->target()->comp());
     double tgt_qty = req->target()->quantity();
-    if (ValidWeights(w_fill, w_tgt, w_fiss)) {
-      double fiss_frac = HighFrac(w_fill, w_tgt, w_fiss);
-      double fill_frac = 1 - fiss_frac;
-      fiss_frac = AtomToMassFrac(fiss_frac, c_fiss, c_fill);
-      fill_frac = AtomToMassFrac(fill_frac, c_fill, c_fiss);
-      Material::Ptr m1 = Material::CreateUntracked(fiss_frac * tgt_qty, c_fiss);
-      Material::Ptr m2 = Material::CreateUntracked(fill_frac * tgt_qty, c_fill);
+    int key = req->target()->comp()->id();
+    Material::Ptr m1 = bid_pool_.Find(key, tgt_qty);
+    if (m1) {
+      // same request composition and quantity as an earlier bid
+      bool exclusive = false;
+      port->AddBid(req, m1, this, exclusive);
+    } else if (f.mode == FuelBlend::FILL_FISS) {
+      m1 = Material::CreateUntracked(f.fiss * tgt_qty, c_fiss);
+      Material::Ptr m2 = Material::CreateUntracked(f.fill * tgt_qty, c_fill);
       m1->Absorb(m2);
+      bid_pool_.Put(key, tgt_qty, m1);
 
       bool exclusive = false;
       port->AddBid(req, m1, this, exclusive);
-    } else if (topup.count() > 0 && ValidWeights(w_fiss, w_tgt, w_topup)) {
+    } else if (topup.count() > 0 && f.mode == FuelBlend::FISS_TOPUP) {
       // only bid with topup if we have filler - otherwise we might be able to
       // meet target with filler when we get it. we should only use topup
       // when the fissile has too poor neutronics.
-      double topup_frac = HighFrac(w_fiss, w_tgt, w_topup);
-      double fiss_frac = 1 - topup_frac;
-      fiss_frac = AtomToMassFrac(fiss_frac, c_fiss, c_topup);
-      topup_frac = AtomToMassFrac(topup_frac, c_topup, c_fiss);
-      Material::Ptr m1 =
-          Material::CreateUntracked(topup_frac * tgt_qty, c_topup);
-      Material::Ptr m2 = Material::CreateUntracked(fiss_frac * tgt_qty, c_fiss);
+      m1 = Material::CreateUntracked(f.topup * tgt_qty, c_topup);
+      Material::Ptr m2 = Material::CreateUntracked(f.fiss * tgt_qty, c_fiss);
       m1->Absorb(m2);
+      bid_pool_.Put(key, tgt_qty, m1);
 
       bool exclusive = false;
       port->AddBid(req, m1, this, exclusive);
@@ -367,12 +408,9 @@ std::set<cyclus::BidPortfolio<Material>::Ptr> FuelFab::GetMatlBids(
     }
   }
 
-  cyclus::Converter<Material>::Ptr fissconv(
-      new FissConverter(c_fill, c_fiss, c_topup, spectrum));
-  cyclus::Converter<Material>::Ptr fillconv(
-      new FillConverter(c_fill, c_fiss, c_topup, spectrum));
-  cyclus::Converter<Material>::Ptr topupconv(
-      new TopupConverter(c_fill, c_fiss, c_topup, spectrum));
+  cyclus::Converter<Material>::Ptr fissconv(new FissConverter(blend));
+  cyclus::Converter<Material>::Ptr fillconv(new FillConverter(blend));
+  cyclus::Converter<Material>::Ptr topupconv(new TopupConverter(blend));
   // important! - the std::max calls prevent CapacityConstraint throwing a zero
   // cap exception
   cyclus::CapacityConstraint<Material> fissc(std::max(fiss.quantity(), 1e-10),
@@ -388,38 +426,82 @@ std::set<cyclus::BidPortfolio<Material>::Ptr> FuelFab::GetMatlBids(
   cyclus::CapacityConstraint<Material> cc(throughput);
   port->AddConstraint(cc);
   ports.insert(port);
+  profile_.Count(ports);
   return ports;
 }
 
+namespace {
+
+// Withdraws the nonzero amounts of qtys (one per trade) from buf together.
+// Each drawn material becomes its trade's response, or is absorbed into it if
+// the trade already drew from another buffer.
+void DrawTrades(cyclus::toolkit::ResBuf<Material>& buf,
+                const std::vector<double>& qtys,
+                std::vector<Material::Ptr>& mats) {
+  std::vector<int> idx;
+  std::vector<double> draws;
+  for (int i = 0; i < qtys.size(); i++) {
+    if (qtys[i] > 0) {
+      idx.push_back(i);
+      draws.push_back(qtys[i]);
+    }
+  }
+  if (idx.empty()) {
+    return;
+  }
+
+  cyclus::toolkit::MatVec out = WithdrawTrades(buf, draws);
+  for (int j = 0; j < idx.size(); j++) {
+    if (mats[idx[j]]) {
+      mats[idx[j]]->Absorb(out[j]);
+    } else {
+      mats[idx[j]] = out[j];
+    }
+  }
+}
+
+}  // namespace
+
 void FuelFab::GetMatlTrades(
     const std::vector<cyclus::Trade<Material> >& trades,
     std::vector<std::pair<cyclus::Trade<Material>, Material::Ptr> >&
         responses) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_TRADES);
   using cyclus::Trade;
 
   // guard against cases where a buffer is empty - this is okay because some 
   // trades may not need that particular buffer.
+  Composition::Ptr c_fill;
   double w_fill = 0;
   if (fill.count() > 0) {
-    w_fill = CosiWeight(fill.Peek()->comp(), spectrum);
+    c_fill = fill.Peek()->comp();
+    w_fill = CosiWeight(c_fill, spectrum);
   }
+  Composition::Ptr c_topup;
   double w_topup = 0;
   if (topup.count() > 0) {
-    w_topup = CosiWeight(topup.Peek()->comp(), spectrum);
+    c_topup = topup.Peek()->comp();
+    w_topup = CosiWeight(c_topup, spectrum);
   }
+  Composition::Ptr c_fiss;
   double w_fiss = 0;
   if (fiss.count() > 0) {
-    w_fiss = CosiWeight(fiss.Peek()->comp(), spectrum);
+    c_fiss = fiss.Peek()->comp();
+    w_fiss = CosiWeight(c_fiss, spectrum);
   }
 
-  std::vector<cyclus::Trade<cyclus::Material> >::const_iterator it;
+  // work out how much each trade takes from each stream first, from the
+  // stream compositions and blend choice fixed at the start of the exchange,
+  // so that each buffer's trades are withdrawn together
+  std::vector<double> fill_qtys(trades.size(), 0);
+  std::vector<double> fiss_qtys(trades.size(), 0);
+  std::vector<double> topup_qtys(trades.size(), 0);
   double tot = 0;
   for (int i = 0; i < trades.size(); i++) {
     Material::Ptr tgt = trades[i].request->target();
 
     double w_tgt = CosiWeight(tgt->comp(), spectrum);
     double qty = trades[i].amt;
-    double wfiss = w_fiss;
 
     tot += qty;
     if (tot > throughput + cyclus::eps_rsrc()) {
@@ -431,289 +513,277 @@ void FuelFab::GetMatlTrades(
 
     if (fiss.count() == 0) {
       // use straight filler to satisfy this request
-      double fillqty = qty;
-      if (std::abs(fillqty - fill.quantity()) < cyclus::eps_rsrc()) {
-        fillqty = std::min(fill.quantity(), qty);
-      }
-      responses.push_back(
-          std::make_pair(trades[i], fill.Pop(fillqty, cyclus::eps_rsrc())));
+      fill_qtys[i] = qty;
     } else if (fill.count() == 0 && ValidWeights(w_fill, w_tgt, w_fiss)) {
       // use straight fissile to satisfy this request
-      double fissqty = qty;
-      if (std::abs(fissqty - fiss.quantity()) < cyclus::eps_rsrc()) {
-        fissqty = std::min(fiss.quantity(), qty);
-      }
-      responses.push_back(
-          std::make_pair(trades[i], fiss.Pop(fissqty, cyclus::eps_rsrc())));
+      fiss_qtys[i] = qty;
     } else if (ValidWeights(w_fill, w_tgt, w_fiss)) {
       double fiss_frac = HighFrac(w_fill, w_tgt, w_fiss);
       double fill_frac = LowFrac(w_fill, w_tgt, w_fiss);
-      fiss_frac =
-          AtomToMassFrac(fiss_frac, fiss.Peek()->comp(), fill.Peek()->comp());
-      fill_frac =
-          AtomToMassFrac(fill_frac, fill.Peek()->comp(), fiss.Peek()->comp());
-
-      double fissqty = fiss_frac * qty;
-      if (std::abs(fissqty - fiss.quantity()) < cyclus::eps_rsrc()) {
-        fissqty = std::min(fiss.quantity(), fiss_frac * qty);
-      }
-      double fillqty = fill_frac * qty;
-      if (std::abs(fillqty - fill.quantity()) < cyclus::eps_rsrc()) {
-        fillqty = std::min(fill.quantity(), fill_frac * qty);
-      }
-
-      Material::Ptr m = fiss.Pop(fissqty, cyclus::eps_rsrc());
-      // this if block prevents zero qty ResBuf pop exceptions
-      if (fill_frac > 0) {
-        m->Absorb(fill.Pop(fillqty, cyclus::eps_rsrc()));
-      }
-      responses.push_back(std::make_pair(trades[i], m));
+      fiss_qtys[i] = AtomToMassFrac(fiss_frac, c_fiss, c_fill) * qty;
+      fill_qtys[i] = AtomToMassFrac(fill_frac, c_fill, c_fiss) * qty;
     } else {
       double topup_frac = HighFrac(w_fiss, w_tgt, w_topup);
       double fiss_frac = 1 - topup_frac;
-      topup_frac =
-          AtomToMassFrac(topup_frac, topup.Peek()->comp(), fiss.Peek()->comp());
-      fiss_frac =
-          AtomToMassFrac(fiss_frac, fiss.Peek()->comp(), topup.Peek()->comp());
-
-      double fissqty = fiss_frac * qty;
-      if (std::abs(fissqty - fiss.quantity()) < cyclus::eps_rsrc()) {
-        fissqty = std::min(fiss.quantity(), fiss_frac * qty);
-      }
-      double topupqty = topup_frac * qty;
-      if (std::abs(topupqty - topup.quantity()) < cyclus::eps_rsrc()) {
-        topupqty = std::min(topup.quantity(), topup_frac * qty);
-      }
-
-      Material::Ptr m = fiss.Pop(fissqty, cyclus::eps_rsrc());
-      // this if block prevents zero qty ResBuf pop exceptions
-      if (topup_frac > 0) {
-        m->Absorb(topup.Pop(topupqty, cyclus::eps_rsrc()));
-      }
-      responses.push_back(std::make_pair(trades[i], m));
+      topup_qtys[i] = AtomToMassFrac(topup_frac, c_topup, c_fiss) * qty;
+      fiss_qtys[i] = AtomToMassFrac(fiss_frac, c_fiss, c_topup) * qty;
     }
   }
+
+  // the fissile stream goes first so that blends absorb into it
+  std::vector<Material::Ptr> mats(trades.size());
+  DrawTrades(fiss, fiss_qtys, mats);
+  DrawTrades(fill, fill_qtys, mats);
+  DrawTrades(topup, topup_qtys, mats);
+
+  for (int i = 0; i < trades.size(); i++) {
+    responses.push_back(std::make_pair(trades[i], mats[i]));
+  }
 }
 
 void FuelFab::RecordPosition() {
-  std::string specification = this->spec();
-  context()
-      ->NewDatum("AgentPosition")
-      ->AddVal("Spec", specification)
-      ->AddVal("Prototype", this->prototype())
-      ->AddVal("AgentId", id())
-      ->AddVal("Latitude", latitude)
-      ->AddVal("Longitude", longitude)
-      ->Record();
+  CompactOutput::RecordPosition(this, latitude, longitude,
+                                 compact_output);
 }
 
 extern "C" cyclus::Agent* ConstructFuelFab(cyclus::Context* ctx) {
   return new FuelFab(ctx);
 }
 
-// Returns the weight of c using 1 group cross sections of type spectrum
-// which must be one of:
-//
-//     * thermal
-//     * thermal_maxwell_ave
-//     * fission_spectrum_ave
-//     * resonance_integral
-//     * fourteen_MeV
-//
-// The weight is calculated as "(nu*sigma_f - sigma_a) * N".  Since weights
-// are computed based on nuclide atom fractions, corresponding computed
-// material/mixing fractions will also be atom-based naturally and will need
-// to be converted to mass-based for actual material object mixing.
-double CosiWeight(cyclus::Composition::Ptr c, const std::string& spectrum) {
-  cyclus::CompMap cm = c->atom();
-  cyclus::compmath::Normalize(&cm);
-
-  if (spectrum == "thermal") {
-    double nu_pu239 = 2.85;
-    double nu_u233 = 2.5;
-    double nu_u235 = 2.43;
-    double nu_u238 = 0;
-    double nu_pu241 = nu_pu239;
-
-    static std::map<int, double> absorb_xs;
-    static std::map<int, double> fiss_xs;
-    static double p_u238 = 0;
-    static double p_pu239 = 0;
-    if (p_u238 == 0) {
-      double fiss_u238 = simple_xs(922380000, "fission", "thermal");
-      double absorb_u238 = simple_xs(922380000, "absorption", "thermal");
-      p_u238 = nu_u238 * fiss_u238 - absorb_u238;
-
-      double fiss_pu239 = simple_xs(942390000, "fission", "thermal");
-      double absorb_pu239 = simple_xs(942390000, "absorption", "thermal");
-      p_pu239 = nu_pu239 * fiss_pu239 - absorb_pu239;
+namespace {
+
+// Number of composition weights each spectrum table remembers before its
+// cache is flushed.  This keeps memory bounded in long simulations where
+// squashed inventories keep producing new compositions.
+const int kMaxCachedWeights = 10000;
+
+// Nuclides whose reactivities are computed up front when the cross section
+// table for a spectrum is built.  Any other nuclide is computed the first time
+// it shows up in a composition.
+const cyclus::Nuc kCommonNucs[] = {
+    922320000, 922330000, 922340000, 922350000, 922360000, 922380000,
+    932370000, 942380000, 942390000, 942400000, 942410000, 942420000,
+    952410000, 952420001, 952430000, 962420000, 962430000, 962440000,
+    962450000, 962460000,
+};
+
+// Serializes the pyne cross section lookups, which fill pyne's own data
+// tables the first time they are used and are not safe to call concurrently.
+std::mutex xs_mutex;
+
+// Read-only one group data for a single spectrum: the neutron yields of the
+// fissile nuclides, the U-238 and Pu-239 reference reactivities and the
+// normalized reactivity (p_i - p_U238) / (p_Pu239 - p_U238) of the common
+// nuclides.  Each table is built once, under xs_mutex, and then shared by all
+// FuelFab instances, converters and threads without further locking.
+class CosiXs {
+ public:
+  explicit CosiXs(const std::string& spectrum) : spectrum_(spectrum) {
+    double pu = spectrum == "thermal" ? 2.85 : 3.1;
+    nu_[922330000] = spectrum == "thermal" ? 2.5 : 2.63;
+    nu_[922350000] = spectrum == "thermal" ? 2.43 : 2.58;
+    nu_[942390000] = pu;
+    nu_[942410000] = pu;
+
+    // U-238 contributes no fission neutrons to the reference reactivity
+    p_u238_ = -simple_xs(922380000, "absorption", spectrum);
+    p_pu239_ = Nu(942390000) * simple_xs(942390000, "fission", spectrum) -
+               simple_xs(942390000, "absorption", spectrum);
+
+    int n = sizeof(kCommonNucs) / sizeof(kCommonNucs[0]);
+    for (int i = 0; i < n; i++) {
+      reactivity_[kCommonNucs[i]] = Compute(kCommonNucs[i]);
     }
+  }
 
-    cyclus::CompMap::iterator it;
-    double w = 0;
-    for (it = cm.begin(); it != cm.end(); ++it) {
-      cyclus::Nuc nuc = it->first;
-      double nu = 0;
-      if (nuc == 922350000) {
-        nu = nu_u235;
-      } else if (nuc == 922330000) {
-        nu = nu_u233;
-      } else if (nuc == 942390000) {
-        nu = nu_pu239;
-      } else if (nuc == 942410000) {
-        nu = nu_pu241;
-      }
-
-      double fiss = 0;
-      double absorb = 0;
-      if (absorb_xs.count(nuc) == 0) {
-        try {
-          fiss = simple_xs(nuc, "fission", "thermal");
-          absorb = simple_xs(nuc, "absorption", "thermal");
-          absorb_xs[nuc] = absorb;
-          fiss_xs[nuc] = fiss;
-        } catch (pyne::InvalidSimpleXS err) {
-          fiss = 0;
-          absorb = 0;
-        }
-      } else {
-        fiss = fiss_xs[nuc];
-        absorb = absorb_xs[nuc];
-      }
-
-      double p = nu * fiss - absorb;
-      w += it->second * (p - p_u238) / (p_pu239 - p_u238);
+  // Sets r to the tabulated reactivity of nuc and returns true, or returns
+  // false if nuc is not one of the common nuclides.
+  bool Find(cyclus::Nuc nuc, double* r) const {
+    std::map<cyclus::Nuc, double>::const_iterator it = reactivity_.find(nuc);
+    if (it == reactivity_.end()) {
+      return false;
     }
-    return w;
-  } else if (spectrum == "fission_spectrum_ave") {
-    double nu_pu239 = 3.1;
-    double nu_u233 = 2.63;
-    double nu_u235 = 2.58;
-    double nu_u238 = 0;
-    double nu_pu241 = nu_pu239;
-
-    static std::map<int, double> absorb_xs;
-    static std::map<int, double> fiss_xs;
-    static double p_u238 = 0;
-    static double p_pu239 = 0;
-    if (p_u238 == 0) {
-      double fiss_u238 =
-          simple_xs(922380000, "fission", "fission_spectrum_ave");
-      double absorb_u238 =
-          simple_xs(922380000, "absorption", "fission_spectrum_ave");
-      p_u238 = nu_u238 * fiss_u238 - absorb_u238;
-
-      double fiss_pu239 =
-          simple_xs(942390000, "fission", "fission_spectrum_ave");
-      double absorb_pu239 =
-          simple_xs(942390000, "absorption", "fission_spectrum_ave");
-      p_pu239 = nu_pu239 * fiss_pu239 - absorb_pu239;
+    *r = it->second;
+    return true;
+  }
+
+  // Computes the reactivity of a nuclide missing from the table.
+  double Lookup(cyclus::Nuc nuc) const {
+    std::lock_guard<std::mutex> lock(xs_mutex);
+    return Compute(nuc);
+  }
+
+ private:
+  double Nu(cyclus::Nuc nuc) const {
+    std::map<cyclus::Nuc, double>::const_iterator it = nu_.find(nuc);
+    return it == nu_.end() ? 0 : it->second;
+  }
+
+  // Must be called with xs_mutex held.
+  double Compute(cyclus::Nuc nuc) const {
+    double fiss = 0;
+    double absorb = 0;
+    try {
+      fiss = simple_xs(nuc, "fission", spectrum_);
+      absorb = simple_xs(nuc, "absorption", spectrum_);
+    } catch (pyne::InvalidSimpleXS err) {
+      fiss = 0;
+      absorb = 0;
     }
 
-    cyclus::CompMap::iterator it;
-    double w = 0;
-    for (it = cm.begin(); it != cm.end(); ++it) {
-      cyclus::Nuc nuc = it->first;
-      double nu = 0;
-      if (nuc == 922350000) {
-        nu = nu_u235;
-      } else if (nuc == 922330000) {
-        nu = nu_u233;
-      } else if (nuc == 942390000) {
-        nu = nu_pu239;
-      } else if (nuc == 942410000) {
-        nu = nu_pu241;
-      }
-
-      double fiss = 0;
-      double absorb = 0;
-      if (absorb_xs.count(nuc) == 0) {
-        try {
-          fiss = simple_xs(nuc, "fission", "fission_spectrum_ave");
-          absorb = simple_xs(nuc, "absorption", "fission_spectrum_ave");
-          absorb_xs[nuc] = absorb;
-          fiss_xs[nuc] = fiss;
-        } catch (pyne::InvalidSimpleXS err) {
-          fiss = 0;
-          absorb = 0;
-        }
-      } else {
-        fiss = fiss_xs[nuc];
-        absorb = absorb_xs[nuc];
-      }
-
-      double p = nu * fiss - absorb;
-      w += it->second * (p - p_u238) / (p_pu239 - p_u238);
+    double p = Nu(nuc) * fiss - absorb;
+    return (p - p_u238_) / (p_pu239_ - p_u238_);
+  }
+
+  std::string spectrum_;
+  std::map<cyclus::Nuc, double> nu_;
+  double p_u238_;
+  double p_pu239_;
+  std::map<cyclus::Nuc, double> reactivity_;
+};
+
+// Returns the shared cross section table for the given spectrum, building it
+// the first time any thread asks for it.  Tables are never modified or
+// removed once built, so the returned reference stays valid.
+const CosiXs& SharedXs(const std::string& spectrum) {
+  static std::map<std::string, CosiXs> tables;
+  std::lock_guard<std::mutex> lock(xs_mutex);
+  std::map<std::string, CosiXs>::iterator it = tables.find(spectrum);
+  if (it == tables.end()) {
+    it = tables.insert(std::make_pair(spectrum, CosiXs(spectrum))).first;
+  }
+  return it->second;
+}
+
+// Per thread weights of every composition already evaluated with one
+// spectrum, plus the reactivities of any uncommon nuclides met so far.
+// Compositions are immutable, so their weights can safely be remembered by
+// composition id.
+class CosiTable {
+ public:
+  explicit CosiTable(const std::string& spectrum)
+      : xs_(&SharedXs(spectrum)) {}
+
+  double Reactivity(cyclus::Nuc nuc) {
+    double r = 0;
+    if (xs_->Find(nuc, &r)) {
+      return r;
     }
-    return w;
-  } else {
-    double nu_pu239 = 3.1;
-    double nu_u233 = 2.63;
-    double nu_u235 = 2.58;
-    double nu_u238 = 0;
-    double nu_pu241 = nu_pu239;
+    std::map<cyclus::Nuc, double>::iterator it = misses_.find(nuc);
+    if (it != misses_.end()) {
+      return it->second;
+    }
+    r = xs_->Lookup(nuc);
+    misses_[nuc] = r;
+    return r;
+  }
 
-    double fiss_u238 = simple_xs(922380000, "fission", spectrum);
-    double absorb_u238 = simple_xs(922380000, "absorption", spectrum);
-    double p_u238 = nu_u238 * fiss_u238 - absorb_u238;
+  double Weight(Composition::Ptr c) {
+    std::map<int, double>::iterator it = weights_.find(c->id());
+    if (it != weights_.end()) {
+      return it->second;
+    }
 
-    double fiss_pu239 = simple_xs(942390000, "fission", spectrum);
-    double absorb_pu239 = simple_xs(942390000, "absorption", spectrum);
-    double p_pu239 = nu_pu239 * fiss_pu239 - absorb_pu239;
+    const cyclus::CompMap& cm = c->atom();
+    cyclus::CompMap::const_iterator cit;
+    double tot = 0;
+    for (cit = cm.begin(); cit != cm.end(); ++cit) {
+      tot += cit->second;
+    }
 
-    cyclus::CompMap::iterator it;
     double w = 0;
-    for (it = cm.begin(); it != cm.end(); ++it) {
-      cyclus::Nuc nuc = it->first;
-      double nu = 0;
-      if (nuc == 922350000) {
-        nu = nu_u235;
-      } else if (nuc == 922330000) {
-        nu = nu_u233;
-      } else if (nuc == 942390000) {
-        nu = nu_pu239;
-      } else if (nuc == 942410000) {
-        nu = nu_pu241;
-      }
-
-      double fiss = 0;
-      double absorb = 0;
-      try {
-        fiss = simple_xs(nuc, "fission", spectrum);
-        absorb = simple_xs(nuc, "absorption", spectrum);
-      } catch (pyne::InvalidSimpleXS err) {
-        fiss = 0;
-        absorb = 0;
-      }
-
-      double p = nu * fiss - absorb;
-      w += it->second * (p - p_u238) / (p_pu239 - p_u238);
+    for (cit = cm.begin(); cit != cm.end(); ++cit) {
+      double n = tot != 0 ? cit->second / tot : cit->second;
+      w += n * Reactivity(cit->first);
     }
+
+    if (weights_.size() >= kMaxCachedWeights) {
+      weights_.clear();
+    }
+    weights_[c->id()] = w;
     return w;
   }
-}
 
-// Convert an atom frac (n1/(n1+n2) to a mass frac (m1/(m1+m2) given
-// corresponding compositions c1 and c2.
-double AtomToMassFrac(double atomfrac, Composition::Ptr c1,
-                      Composition::Ptr c2) {
-  cyclus::CompMap n1 = c1->atom();
-  cyclus::CompMap n2 = c2->atom();
-  cyclus::compmath::Normalize(&n1, atomfrac);
-  cyclus::compmath::Normalize(&n2, 1 - atomfrac);
+ private:
+  const CosiXs* xs_;
+  std::map<cyclus::Nuc, double> misses_;
+  std::map<int, double> weights_;
+};
 
-  cyclus::CompMap::iterator it;
+// Returns the (lazily created) table for the given spectrum.  Every thread
+// has its own weight caches, so lookups and cache updates never need a lock;
+// only building a spectrum's shared cross sections and reading the cross
+// sections of uncommon nuclides are serialized.
+CosiTable& SpectrumTable(const std::string& spectrum) {
+  static thread_local std::map<std::string, CosiTable> tables;
+  std::map<std::string, CosiTable>::iterator it = tables.find(spectrum);
+  if (it == tables.end()) {
+    it = tables.insert(std::make_pair(spectrum, CosiTable(spectrum))).first;
+  }
+  return it->second;
+}
+
+// Returns the average molar mass (g/mol) of c.  Compositions are immutable,
+// so the result is remembered per thread by composition id; the cache is
+// flushed when it grows past kMaxCachedWeights entries.
+double MolarMass(Composition::Ptr c) {
+  static thread_local std::map<int, double> masses;
+  std::map<int, double>::iterator it = masses.find(c->id());
+  if (it != masses.end()) {
+    return it->second;
+  }
 
-  double mass1 = 0;
-  for (it = n1.begin(); it != n1.end(); ++it) {
-    mass1 += it->second * pyne::atomic_mass(it->first);
+  const cyclus::CompMap& atom = c->atom();
+  double tot = 0;
+  double mass = 0;
+  cyclus::CompMap::const_iterator nit;
+  for (nit = atom.begin(); nit != atom.end(); ++nit) {
+    tot += nit->second;
+    mass += nit->second * pyne::atomic_mass(nit->first);
+  }
+  if (tot > 0) {
+    mass /= tot;
   }
 
-  double mass2 = 0;
-  for (it = n2.begin(); it != n2.end(); ++it) {
-    mass2 += it->second * pyne::atomic_mass(it->first);
+  if (masses.size() >= kMaxCachedWeights) {
+    masses.clear();
   }
+  masses[c->id()] = mass;
+  return mass;
+}
+
+}  // namespace
+
+// Returns the weight of c using 1 group cross sections of type spectrum
+// which must be one of:
+//
+//     * thermal
+//     * thermal_maxwell_ave
+//     * fission_spectrum_ave
+//     * resonance_integral
+//     * fourteen_MeV
+//
+// The weight is calculated as "(nu*sigma_f - sigma_a) * N".  Since weights
+// are computed based on nuclide atom fractions, corresponding computed
+// material/mixing fractions will also be atom-based naturally and will need
+// to be converted to mass-based for actual material object mixing.
+//
+// Per-nuclide reactivities and per-composition weights are cached for each
+// spectrum, so repeated evaluations of the same composition (e.g. a reactor
+// recipe requested every time step) cost a single lookup.  The caches are
+// kept per thread, so agents may compute weights concurrently as long as
+// each composition's atom fractions have been computed before it is shared
+// across threads (cyclus computes them lazily).
+double CosiWeight(cyclus::Composition::Ptr c, const std::string& spectrum) {
+  return SpectrumTable(spectrum).Weight(c);
+}
 
+// Convert an atom frac (n1/(n1+n2) to a mass frac (m1/(m1+m2) given
+// corresponding compositions c1 and c2.
+double AtomToMassFrac(double atomfrac, Composition::Ptr c1,
+                      Composition::Ptr c2) {
+  double mass1 = atomfrac * MolarMass(c1);
+  double mass2 = (1 - atomfrac) * MolarMass(c2);
   return mass1 / (mass1 + mass2);
 }
 
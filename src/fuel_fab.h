@@ -4,6 +4,8 @@
 #include <string>
 #include "cyclus.h"
 #include "cycamore_version.h"
+#include "material_pool.h"
+#include "phase_profile.h"
 
 namespace cycamore {
 
@@ -114,7 +116,14 @@ class FuelFab
 #pragma cyclus
 
   virtual void Tick(){};
-  virtual void Tock(){};
+  virtual void Tock() {
+    PhaseProfile::Scope scope(&profile_, PhaseProfile::TOCK);
+    bid_pool_.Reset();
+  };
+  virtual void Decommission() {
+    profile_.Flush();
+    cyclus::Facility::Decommission();
+  };
   virtual void EnterNotify();
 
   virtual std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> GetMatlBids(
@@ -269,10 +278,38 @@ class FuelFab
   }
   double longitude;
 
+  #pragma cyclus var { \
+    "default": "", \
+    "uilabel": "Compact Output Mode", \
+    "userlevel": 10, \
+    "doc": "Output mode for this agent's position. Empty or 'off' " \
+           "writes the regular tables. 'batches' writes the position to " \
+           "AgentPositionCompact, as does 'runs'.", \
+  }
+  std::string compact_output;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Profile Phases", \
+    "userlevel": 10, \
+    "doc": "If true, this facility records its call counts, wall time " \
+           "and bids or requests emitted for each phase of the time step. " \
+           "The whole-simulation totals are written to the AgentPhaseTimes " \
+           "table at the end of the simulation or when the facility is " \
+           "decommissioned.", \
+  }
+  bool profile_phases;
+
   cyclus::toolkit::Position coordinates;
 
   /// Records an agent's latitude and longitude to the output db
   void RecordPosition();
+
+  // blended bid offers of the current time step keyed by request
+  // composition
+  MaterialPool bid_pool_;
+
+  PhaseProfile profile_;
 };
 
 double CosiWeight(cyclus::Composition::Ptr c, const std::string& spectrum);
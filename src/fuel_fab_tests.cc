@@ -2,6 +2,8 @@
 
 #include <gtest/gtest.h>
 #include <sstream>
+#include <thread>
+#include <vector>
 #include "cyclus.h"
 
 using pyne::nucname::id;
@@ -121,6 +123,34 @@ TEST(FuelFabTests, CosiWeight) {
   EXPECT_GT(w_therm, w_fast);
 }
 
+TEST(FuelFabTests, CosiWeight_Threads) {
+  cyclus::Env::SetNucDataPath();
+  std::vector<Composition::Ptr> comps;
+  comps.push_back(c_uox());
+  comps.push_back(c_pustream());
+  comps.push_back(c_natu());
+  std::vector<double> want;
+  for (int i = 0; i < comps.size(); ++i) {
+    want.push_back(CosiWeight(comps[i], "thermal"));
+  }
+
+  // each thread starts from an empty cache and must get the same weights
+  int nthreads = 4;
+  std::vector<std::vector<double> > got(nthreads);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < nthreads; ++t) {
+    threads.push_back(std::thread([&comps, &got, t]() {
+      for (int i = 0; i < comps.size(); ++i) {
+        got[t].push_back(CosiWeight(comps[i], "thermal"));
+      }
+    }));
+  }
+  for (int t = 0; t < nthreads; ++t) {
+    threads[t].join();
+    EXPECT_EQ(want, got[t]);
+  }
+}
+
 TEST(FuelFabTests, CosiWeight_Mixed) {
   cyclus::Env::SetNucDataPath();
   double w_fill = CosiWeight(c_natu(), "thermal");
@@ -141,6 +171,38 @@ TEST(FuelFabTests, CosiWeight_Mixed) {
   EXPECT_LT(std::abs((w_target-got)/w_target), 0.00001) << "mixed composition not within 0.001% of target";
 }
 
+TEST(FuelFabTests, CosiWeight_AllSpectra) {
+  cyclus::Env::SetNucDataPath();
+  std::string spectra[] = {"thermal", "thermal_maxwell_ave",
+                           "fission_spectrum_ave", "resonance_integral",
+                           "fourteen_MeV"};
+  for (int i = 0; i < 5; i++) {
+    CompMap m;
+    m[942390000] = 1;
+    Composition::Ptr c = Composition::CreateFromMass(m);
+    EXPECT_DOUBLE_EQ(1.0, CosiWeight(c, spectra[i])) << spectra[i];
+
+    m.clear();
+    m[922380000] = 1;
+    c = Composition::CreateFromMass(m);
+    EXPECT_DOUBLE_EQ(0.0, CosiWeight(c, spectra[i])) << spectra[i];
+  }
+}
+
+TEST(FuelFabTests, CosiWeight_Cached) {
+  cyclus::Env::SetNucDataPath();
+  Composition::Ptr c = c_mox();
+  double w = CosiWeight(c, "thermal");
+  EXPECT_DOUBLE_EQ(w, CosiWeight(c, "thermal"));
+
+  // a distinct composition object with identical contents must get the same
+  // weight as the cached one.
+  EXPECT_DOUBLE_EQ(w, CosiWeight(c_mox(), "thermal"));
+
+  // cached weights are per spectrum
+  EXPECT_NE(w, CosiWeight(c, "fission_spectrum_ave"));
+}
+
 TEST(FuelFabTests, HighFrac) {
   cyclus::Env::SetNucDataPath();
   double w_fill = CosiWeight(c_natu(), "thermal");
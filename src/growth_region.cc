@@ -1,12 +1,19 @@
 // Implements the GrowthRegion class
 #include "growth_region.h"
 
+#include <algorithm>
+
+#include "compact_output.h"
+#include "manager_inst.h"
+
 namespace cycamore {
 
 GrowthRegion::GrowthRegion(cyclus::Context* ctx)
     : cyclus::Region(ctx),
+      build_horizon(0),
       latitude(0.0),
       longitude(0.0),
+      compact_output(""),
       coordinates(latitude, longitude) { 
 	#if !CYCLUS_HAS_COIN
     throw cyclus::Error("Growth Region requires that Cyclus & Cycamore be compiled "
@@ -37,24 +44,28 @@ void GrowthRegion::AddCommodityDemand_(std::string commod,
   // register the commodity and demand
   cyclus::toolkit::Commodity c(commod);
   sdmanager_.RegisterCommodity(c, pff.GetFunctionPtr());
+  commods_[commod].commod = c;
 }
 
 void GrowthRegion::EnterNotify() {
   cyclus::Region::EnterNotify();
-  std::set<cyclus::Agent*>::iterator ait;
-  for (ait = cyclus::Agent::children().begin();
-       ait != cyclus::Agent::children().end();
-       ++ait) {
-    Agent* a = *ait;
-    Register_(a);
-  }
 
+  // demand is registered first so that the supply of the children is tallied
+  // for every demanded commodity as they are registered
   std::map<std::string, Demand>::iterator it;
   for (it = commodity_demand.begin(); it != commodity_demand.end(); ++it) {
     LOG(cyclus::LEV_INFO3, "greg") << "Adding demand for commodity "
                                    << it->first;
     AddCommodityDemand_(it->first, it->second);
   }
+
+  std::set<cyclus::Agent*>::iterator ait;
+  for (ait = cyclus::Agent::children().begin();
+       ait != cyclus::Agent::children().end();
+       ++ait) {
+    Agent* a = *ait;
+    Register_(a);
+  }
   RecordPosition();
 }
 
@@ -73,6 +84,16 @@ void GrowthRegion::Register_(cyclus::Agent* agent) {
                                    << agent->prototype() << agent->id()
                                    << " as a commodity producer manager.";
     sdmanager_.RegisterProducerManager(cpm_cast);
+    ManagerInst* mi_cast = dynamic_cast<ManagerInst*>(agent);
+    if (mi_cast != NULL) {
+      tracked_.insert(cpm_cast);
+      std::map<std::string, CommodState>::iterator it;
+      for (it = commods_.begin(); it != commods_.end(); ++it) {
+        it->second.supply += mi_cast->Capacity(it->first);
+      }
+    } else {
+      polled_.insert(cpm_cast);
+    }
   }
 
   Builder* b_cast = dynamic_cast<Builder*>(agent);
@@ -94,8 +115,17 @@ void GrowthRegion::Unregister_(cyclus::Agent* agent) {
 #if CYCLUS_HAS_COIN
   CommodityProducerManager* cpm_cast =
     dynamic_cast<CommodityProducerManager*>(agent);
-  if (cpm_cast != NULL)
+  if (cpm_cast != NULL) {
     sdmanager_.UnregisterProducerManager(cpm_cast);
+    ManagerInst* mi_cast = dynamic_cast<ManagerInst*>(agent);
+    if (tracked_.erase(cpm_cast) > 0 && mi_cast != NULL) {
+      std::map<std::string, CommodState>::iterator it;
+      for (it = commods_.begin(); it != commods_.end(); ++it) {
+        it->second.supply -= mi_cast->Capacity(it->first);
+      }
+    }
+    polled_.erase(cpm_cast);
+  }
 
   Builder* b_cast = dynamic_cast<Builder*>(agent);
   if (b_cast != NULL)
@@ -106,15 +136,49 @@ void GrowthRegion::Unregister_(cyclus::Agent* agent) {
 #endif
 }
 
+void GrowthRegion::ProducerNotify(
+    cyclus::toolkit::CommodityProducerManager* mgr,
+    cyclus::toolkit::CommodityProducer* producer,
+    double sign) {
+  if (tracked_.count(mgr) == 0) {
+    return;
+  }
+
+  std::map<std::string, CommodState>::iterator it;
+  for (it = commods_.begin(); it != commods_.end(); ++it) {
+    if (producer->Produces(it->second.commod)) {
+      it->second.supply += sign * producer->Capacity(it->second.commod);
+    }
+  }
+}
+
+double GrowthRegion::Supply_(const std::string& commod) {
+  CommodState& s = commods_[commod];
+  double supply = s.supply;
+  std::set<cyclus::toolkit::CommodityProducerManager*>::iterator it;
+  for (it = polled_.begin(); it != polled_.end(); ++it) {
+    supply += (*it)->TotalCapacity(s.commod);
+  }
+  return supply;
+}
+
+double GrowthRegion::Demand_(const std::string& commod, int time) {
+  CommodState& s = commods_[commod];
+  if (s.demand_time != time) {
+    s.demand = sdmanager_.Demand(s.commod, time);
+    s.demand_time = time;
+  }
+  return s.demand;
+}
+
 void GrowthRegion::Tick() {
   double demand, supply, unmetdemand;
-  cyclus::toolkit::Commodity commod;
   int time = context()->time();
-  std::map<std::string, Demand>::iterator it;
-  for (it = commodity_demand.begin(); it != commodity_demand.end(); ++it) {
-    commod = cyclus::toolkit::Commodity(it->first);
-    demand = sdmanager_.Demand(commod, time);
-    supply = sdmanager_.Supply(commod);
+  std::map<std::string, CommodState>::iterator it;
+  for (it = commods_.begin(); it != commods_.end(); ++it) {
+    cyclus::toolkit::Commodity& commod = it->second.commod;
+    demand = Demand_(it->first, time);
+    supply = Supply_(it->first);
     unmetdemand = demand - supply;
 
     LOG(cyclus::LEV_INFO3, "greg") << "GrowthRegion: " << prototype()
@@ -125,7 +189,9 @@ void GrowthRegion::Tick() {
     LOG(cyclus::LEV_INFO3, "greg") << "  * supply = " << supply;
     LOG(cyclus::LEV_INFO3, "greg") << "  * unmet demand = " << unmetdemand;
 
-    if (unmetdemand > 0) {
+    if (build_horizon > 0) {
+      PlanBuilds_(it->first, time);
+    } else if (unmetdemand > 0) {
       OrderBuilds(commod, unmetdemand);
     }
   }
@@ -174,16 +240,100 @@ void GrowthRegion::OrderBuilds(cyclus::toolkit::Commodity& commodity,
 #endif
 }
 
+void GrowthRegion::PlanBuilds_(const std::string& commod, int time) {
+#if CYCLUS_HAS_COIN
+  CommodState& s = commods_[commod];
+  double supply = Supply_(commod);
+  if (time < s.plan_end && supply >= s.planned[time] - cyclus::eps()) {
+    return;
+  }
+
+  // builds scheduled by earlier plans for later steps are still on their
+  // way, so only the demand they leave uncovered is planned for
+  s.pending.erase(s.pending.begin(), s.pending.upper_bound(time));
+  std::map<int, double>::iterator pit = s.pending.begin();
+  double queued = 0;
+  std::vector<double> demand(build_horizon);
+  double unmetdemand = 0;
+  for (int i = 0; i < build_horizon; i++) {
+    for (; pit != s.pending.end() && pit->first <= time + i; ++pit) {
+      queued += pit->second;
+    }
+    demand[i] = (i == 0 ? Demand_(commod, time) :
+                 sdmanager_.Demand(s.commod, time + i)) - queued;
+    unmetdemand = std::max(unmetdemand, demand[i] - supply);
+  }
+
+  s.plan_end = time + build_horizon;
+  s.planned.clear();
+  std::vector<cyclus::toolkit::BuildOrder> orders;
+  if (unmetdemand > 0) {
+    orders = buildmanager_.MakeBuildDecision(s.commod, unmetdemand);
+  }
+
+  std::vector<cyclus::Institution*> builders;
+  std::vector<cyclus::Agent*> protos;
+  std::vector<double> caps;
+  for (int i = 0; i < orders.size(); i++) {
+    cyclus::toolkit::BuildOrder& order = orders[i];
+    cyclus::Institution* instcast =
+        dynamic_cast<cyclus::Institution*>(order.builder);
+    cyclus::Agent* agentcast = dynamic_cast<cyclus::Agent*>(order.producer);
+    if (!instcast || !agentcast) {
+      throw cyclus::CastError("growth_region has tried to incorrectly "
+                              "cast an already known entity.");
+    }
+    for (int j = 0; j < order.number; j++) {
+      builders.push_back(instcast);
+      protos.push_back(agentcast);
+      caps.push_back(order.producer->Capacity(s.commod));
+    }
+  }
+
+  LOG(cyclus::LEV_INFO3, "greg")
+      << "A build plan of " << caps.size() << " unit(s) covering time steps "
+      << time << " to " << s.plan_end - 1 << " has been determined.";
+
+  // units needed this step can not be built before the next one
+  std::vector<int> steps = ScheduleUnits(supply, demand, caps);
+  for (int i = 0; i < steps.size(); i++) {
+    int t = std::max(time + steps[i], time + 1);
+    context()->SchedBuild(builders[i], protos[i]->prototype(), t);
+    s.pending[t] += caps[i];
+  }
+
+  // the expected supply at each step adds up the old and new pending builds
+  double expected = supply;
+  for (int t = time; t < s.plan_end; t++) {
+    pit = s.pending.find(t);
+    if (pit != s.pending.end()) {
+      expected += pit->second;
+    }
+    s.planned[t] = expected;
+  }
+#else
+  throw cyclus::Error("Growth Region requires that Cyclus & Cycamore be compiled "
+                      "with COIN support.");
+#endif
+}
+
 void GrowthRegion::RecordPosition() {
-  std::string specification = this->spec();
-  context()
-      ->NewDatum("AgentPosition")
-      ->AddVal("Spec", specification)
-      ->AddVal("Prototype", this->prototype())
-      ->AddVal("AgentId", id())
-      ->AddVal("Latitude", latitude)
-      ->AddVal("Longitude", longitude)
-      ->Record();
+  CompactOutput::RecordPosition(this, latitude, longitude,
+                                 compact_output);
+}
+
+std::vector<int> ScheduleUnits(double supply, const std::vector<double>& demand,
+                               const std::vector<double>& caps) {
+  std::vector<int> steps(caps.size(), demand.size() - 1);
+  int unit = 0;
+  for (int i = 0; i < demand.size() && unit < caps.size(); i++) {
+    while (unit < caps.size() && demand[i] > supply + cyclus::eps()) {
+      supply += caps[unit];
+      steps[unit] = i;
+      unit++;
+    }
+  }
+  return steps;
 }
 
 extern "C" cyclus::Agent* ConstructGrowthRegion(cyclus::Context* ctx) {
@@ -1,6 +1,8 @@
 #ifndef CYCAMORE_SRC_GROWTH_REGION_H_
 #define CYCAMORE_SRC_GROWTH_REGION_H_
 
+#include <map>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
@@ -69,6 +71,18 @@ class GrowthRegion : public cyclus::Region,
     return &sdmanager_;
   }
 
+  /// Adjusts the tracked supply when a producer is registered with (sign = 1)
+  /// or unregistered from (sign = -1) one of this region's producer managers.
+  /// ManagerInst calls this from its build and decommission notifications so
+  /// that supply does not have to be recomputed by walking every producer.
+  /// Changes for managers that are not tracked incrementally are ignored.
+  /// @param mgr the manager whose producers changed
+  /// @param producer the producer that was added or removed
+  /// @param sign 1 for an added producer, -1 for a removed one
+  void ProducerNotify(cyclus::toolkit::CommodityProducerManager* mgr,
+                      cyclus::toolkit::CommodityProducer* producer,
+                      double sign);
+
  protected:
   #pragma cyclus var { \
     "alias": ["growth", "commod", \
@@ -122,13 +136,69 @@ class GrowthRegion : public cyclus::Region,
   /// facilities be built
   void AddCommodityDemand_(std::string commod, Demand& demand);
 
+  /// returns the supply of a demanded commodity, i.e., the incrementally
+  /// tracked capacity plus that of any managers that must be polled
+  double Supply_(const std::string& commod);
+
+  /// returns the demand for a commodity at a time, evaluating the demand
+  /// function at most once per commodity and time step
+  double Demand_(const std::string& commod, int time);
+
   /// orders builds given a commodity and an unmet demand for production
   /// capacity of that commodity
   /// @param commodity the commodity being demanded
   /// @param unmetdemand the unmet demand
   void OrderBuilds(cyclus::toolkit::Commodity& commodity, double unmetdemand);
 
+  /// plans builds for a commodity over the build horizon starting at time.
+  /// A new plan is made only when the previous one has run out or the supply
+  /// has fallen below what the plan expected.
+  void PlanBuilds_(const std::string& commod, int time);
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "userlevel": 10, \
+    "uilabel": "Build Planning Horizon", \
+    "doc": "Number of time steps to plan builds over. If zero, builds are " \
+           "ordered every time step for that step's unmet demand. " \
+           "Otherwise a single build decision covers the largest unmet " \
+           "demand over the horizon, and each unit is scheduled for the " \
+           "step at which it is first needed. Builds are only re-planned " \
+           "once the horizon has passed or the supply falls short of the " \
+           "plan.", \
+  }
+  int build_horizon;
+
   private:
+  /// Growth state of a demanded commodity kept between time steps.
+  struct CommodState {
+    CommodState() : supply(0), demand_time(-1), demand(0), plan_end(-1) {}
+
+    cyclus::toolkit::Commodity commod;
+    /// capacity of the incrementally tracked producer managers
+    double supply;
+    /// time step at which demand was last evaluated
+    int demand_time;
+    double demand;
+    /// first time step after the current build plan
+    int plan_end;
+    /// supply expected by the current build plan at each time step
+    std::map<int, double> planned;
+    /// capacity of the scheduled builds that have not happened yet, by build
+    /// time step
+    std::map<int, double> pending;
+  };
+
+  /// demanded commodities by name, built once when demand is registered
+  std::map<std::string, CommodState> commods_;
+
+  /// producer managers whose supply is updated through ProducerNotify
+  std::set<cyclus::toolkit::CommodityProducerManager*> tracked_;
+
+  /// producer managers that do not notify on changes and must be queried
+  /// every time step
+  std::set<cyclus::toolkit::CommodityProducerManager*> polled_;
+
   #pragma cyclus var { \
     "default": 0.0, \
     "uilabel": "Geographical latitude in degrees as a double", \
@@ -145,11 +215,32 @@ class GrowthRegion : public cyclus::Region,
   }
   double longitude;
 
+  #pragma cyclus var { \
+    "default": "", \
+    "uilabel": "Compact Output Mode", \
+    "userlevel": 10, \
+    "doc": "Output mode for this agent's position. Empty or 'off' " \
+           "writes the regular tables. 'batches' writes the position to " \
+           "AgentPositionCompact, as does 'runs'.", \
+  }
+  std::string compact_output;
+
   cyclus::toolkit::Position coordinates;
 
   /// Records an agent's latitude and longitude to the output db
   void RecordPosition();
 };
+/// Assigns each unit of a build plan to the first step of a planning window at
+/// which it is needed, i.e., at which the demand exceeds the starting supply
+/// plus the capacity of the units assigned before it. Units that are never
+/// needed are assigned to the last step.
+/// @param supply the supply at the start of the window
+/// @param demand the demand at each step of the window
+/// @param caps the capacity of each unit in build order
+/// @return the window step at which each unit should be in service
+std::vector<int> ScheduleUnits(double supply, const std::vector<double>& demand,
+                               const std::vector<double>& caps);
+
 }  // namespace cycamore
 
 #endif  // CYCAMORE_SRC_GROWTH_REGION_H_
@@ -1,3 +1,4 @@
+#include <cstdlib>
 #include <sstream>
 
 #include "growth_region_tests.h"
@@ -26,6 +27,60 @@ bool GrowthRegionTests::ManagesCommodity(cyclus::toolkit::Commodity& commodity)
   return region->sdmanager()->ManagesCommodity(commodity);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void GrowthRegionTests::AddDemand() {
+  cycamore::Demand demand;
+  demand.push_back(std::make_pair(std::atoi(demand_start.c_str()),
+                                  std::make_pair(demand_type, demand_params)));
+  region->AddCommodityDemand_(commodity_name, demand);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double GrowthRegionTests::Supply() {
+  return region->Supply_(commodity_name);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double GrowthRegionTests::DemandAt(int time) {
+  return region->Demand_(commodity_name, time);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void GrowthRegionTests::Register(cyclus::Agent* agent) {
+  region->Register_(agent);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void GrowthRegionTests::Unregister(cyclus::Agent* agent) {
+  region->Unregister_(agent);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void GrowthRegionTests::SetHorizon(int horizon) {
+  region->build_horizon = horizon;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void GrowthRegionTests::PlanBuilds(int time) {
+  region->PlanBuilds_(commodity_name, time);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double GrowthRegionTests::Planned(int time) {
+  return region->commods_[commodity_name].planned[time];
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double GrowthRegionTests::Pending() {
+  double tot = 0;
+  std::map<int, double>& pending = region->commods_[commodity_name].pending;
+  std::map<int, double>::iterator it;
+  for (it = pending.begin(); it != pending.end(); ++it) {
+    tot += it->second;
+  }
+  return tot;
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(GrowthRegionTests, init) {
   cyclus::toolkit::Commodity commodity(commodity_name);
@@ -34,6 +89,122 @@ TEST_F(GrowthRegionTests, init) {
   EXPECT_TRUE(ManagesCommodity(commodity));
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(GrowthRegionTests, IncrementalSupply) {
+  using cyclus::toolkit::Commodity;
+  AddDemand();
+  EXPECT_DOUBLE_EQ(0, Supply());
+  EXPECT_DOUBLE_EQ(5, DemandAt(0));
+  EXPECT_DOUBLE_EQ(15, DemandAt(2));
+
+  TestProducer* p1 = new TestProducer(ctx);
+  TestProducer* p2 = new TestProducer(ctx);
+  TestProducer* other = new TestProducer(ctx);
+  p1->cyclus::toolkit::CommodityProducer::Add(Commodity(commodity_name));
+  p1->SetCapacity(Commodity(commodity_name), 10);
+  p2->cyclus::toolkit::CommodityProducer::Add(Commodity(commodity_name));
+  p2->SetCapacity(Commodity(commodity_name), 4);
+  other->cyclus::toolkit::CommodityProducer::Add(Commodity("other"));
+  other->SetCapacity(Commodity("other"), 100);
+
+  // supply already held by the manager is tallied on registration
+  ManagerInst* mgr = new ManagerInst(ctx);
+  mgr->BuildNotify(p1);
+  Register(mgr);
+  EXPECT_DOUBLE_EQ(10, Supply());
+
+  // later builds and decommissions arrive as notifications
+  mgr->BuildNotify(p2);
+  region->ProducerNotify(mgr, p2, 1);
+  region->ProducerNotify(mgr, other, 1);
+  EXPECT_DOUBLE_EQ(14, Supply());
+  mgr->DecomNotify(p1);
+  region->ProducerNotify(mgr, p1, -1);
+  EXPECT_DOUBLE_EQ(4, Supply());
+
+  Unregister(mgr);
+  EXPECT_DOUBLE_EQ(0, Supply());
+  region->ProducerNotify(mgr, p2, -1);
+  EXPECT_DOUBLE_EQ(0, Supply());
+
+  delete mgr;
+  delete other;
+  delete p2;
+  delete p1;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(GrowthRegionTests, Replan) {
+  using cyclus::toolkit::Commodity;
+  AddDemand();  // 5, 10, 15, 20, ... at t = 0, 1, 2, 3, ...
+  SetHorizon(3);
+
+  TestProducer* proto = new TestProducer(ctx);
+  proto->prototype("unit");
+  proto->cyclus::toolkit::CommodityProducer::Add(Commodity(commodity_name));
+  proto->SetCapacity(Commodity(commodity_name), 5);
+  proto->SetCost(Commodity(commodity_name), 1);
+  ManagerInst* mgr = new ManagerInst(ctx);
+  mgr->cyclus::toolkit::Builder::Register(proto);
+  Register(mgr);
+
+  // three units cover the first window: two at t = 1 and one at t = 2
+  PlanBuilds(0);
+  EXPECT_DOUBLE_EQ(15, Pending());
+  EXPECT_DOUBLE_EQ(10, Planned(1));
+  EXPECT_DOUBLE_EQ(15, Planned(2));
+
+  // only one of the t = 1 units is left, the other was decommissioned
+  TestProducer* a = new TestProducer(ctx);
+  a->cyclus::toolkit::CommodityProducer::Add(Commodity(commodity_name));
+  a->SetCapacity(Commodity(commodity_name), 5);
+  mgr->BuildNotify(a);
+  region->ProducerNotify(mgr, a, 1);
+  EXPECT_DOUBLE_EQ(5, Supply());
+
+  // the re-plan only orders what the unit still due at t = 2 leaves open:
+  // one more unit at t = 2 and one at t = 3
+  PlanBuilds(1);
+  EXPECT_DOUBLE_EQ(15, Pending());
+  EXPECT_DOUBLE_EQ(5, Planned(1));
+  EXPECT_DOUBLE_EQ(15, Planned(2));
+  EXPECT_DOUBLE_EQ(20, Planned(3));
+
+  // on track again: no new plan
+  PlanBuilds(1);
+  EXPECT_DOUBLE_EQ(15, Pending());
+
+  Unregister(mgr);
+  delete mgr;
+  delete a;
+  delete proto;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST(GrowthRegionPlanTests, ScheduleUnits) {
+  double d[] = {8, 12, 20, 21};
+  std::vector<double> demand(d, d + 4);
+  std::vector<double> caps(4, 5);
+
+  // each unit goes in at the first step that needs it and the unneeded
+  // fourth one at the end of the window
+  std::vector<int> steps = ScheduleUnits(10, demand, caps);
+  ASSERT_EQ(4, steps.size());
+  EXPECT_EQ(1, steps[0]);
+  EXPECT_EQ(2, steps[1]);
+  EXPECT_EQ(3, steps[2]);
+  EXPECT_EQ(3, steps[3]);
+
+  // a shortfall at the first step takes as many units as it needs at once
+  steps = ScheduleUnits(0, demand, caps);
+  EXPECT_EQ(0, steps[0]);
+  EXPECT_EQ(0, steps[1]);
+  EXPECT_EQ(1, steps[2]);
+  EXPECT_EQ(2, steps[3]);
+
+  EXPECT_TRUE(ScheduleUnits(10, demand, std::vector<double>()).empty());
+}
+
 }  // namespace cycamore
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -7,6 +7,8 @@
 
 #include "context.h"
 #include "growth_region.h"
+#include "manager_inst.h"
+#include "manager_inst_tests.h"
 #include "recorder.h"
 #include "timer.h"
 
@@ -29,6 +31,15 @@ class GrowthRegionTests : public ::testing::Test {
   virtual void SetUp();
   virtual void TearDown();
   bool ManagesCommodity(cyclus::toolkit::Commodity& commodity);
+  void AddDemand();
+  double Supply();
+  double DemandAt(int time);
+  void Register(cyclus::Agent* agent);
+  void Unregister(cyclus::Agent* agent);
+  void SetHorizon(int horizon);
+  void PlanBuilds(int time);
+  double Planned(int time);
+  double Pending();
 };
 
 }  // namespace cycamore
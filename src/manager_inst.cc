@@ -1,13 +1,23 @@
 // Implements the ManagerInst class
 #include "manager_inst.h"
 
+#include "compact_output.h"
+#include "growth_region.h"
+
 namespace cycamore {
 
+namespace {
+
+const std::set<cyclus::toolkit::CommodityProducer*> no_producers;
+
+}  // namespace
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 ManagerInst::ManagerInst(cyclus::Context* ctx)
       : cyclus::Institution(ctx),
         latitude(0.0),
         longitude(0.0),
+        compact_output(""),
         coordinates(latitude, longitude) {}
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -34,11 +44,15 @@ void ManagerInst::EnterNotify() {
   using cyclus::toolkit::CommodityProducer;
   std::vector<std::string>::iterator vit;
   for (vit = prototypes.begin(); vit != prototypes.end(); ++vit) {
+    if (proto_producers_.count(*vit) > 0) {
+      continue;  // listed more than once
+    }
     Agent* a = context()->CreateAgent<Agent>(*vit);
     CommodityProducer* cp_cast = dynamic_cast<CommodityProducer*>(a);
+    proto_producers_[*vit] = cp_cast;
     if (cp_cast != NULL) {
       LOG(cyclus::LEV_INFO3, "mani") << "Registering prototype "
-                                     << a->prototype() << a->id()
+                                     << *vit
                                      << " with the Builder interface.";
       Builder::Register(cp_cast);
     }
@@ -50,12 +64,18 @@ void ManagerInst::Register_(Agent* a) {
   using cyclus::toolkit::CommodityProducer;
   using cyclus::toolkit::CommodityProducerManager;
 
+  if (children_.count(a) > 0)
+    return;
+
   CommodityProducer* cp_cast = dynamic_cast<CommodityProducer*>(a);
   if (cp_cast != NULL) {
     LOG(cyclus::LEV_INFO3, "mani") << "Registering agent "
                                    << a->prototype() << a->id()
                                    << " as a commodity producer.";
+    children_[a] = cp_cast;
     CommodityProducerManager::Register(cp_cast);
+    Index_(cp_cast, 1);
+    NotifyRegion_(cp_cast, 1);
   }
 }
 
@@ -63,9 +83,52 @@ void ManagerInst::Unregister_(Agent* a) {
   using cyclus::toolkit::CommodityProducer;
   using cyclus::toolkit::CommodityProducerManager;
 
-  CommodityProducer* cp_cast = dynamic_cast<CommodityProducer*>(a);
-  if (cp_cast != NULL)
-    CommodityProducerManager::Unregister(cp_cast);
+  std::map<Agent*, CommodityProducer*>::iterator it = children_.find(a);
+  if (it == children_.end())
+    return;
+
+  CommodityProducer* cp_cast = it->second;
+  children_.erase(it);
+  CommodityProducerManager::Unregister(cp_cast);
+  Index_(cp_cast, -1);
+  NotifyRegion_(cp_cast, -1);
+}
+
+void ManagerInst::Index_(cyclus::toolkit::CommodityProducer* producer,
+                         double sign) {
+  using cyclus::toolkit::Commodity;
+  using cyclus::toolkit::CommodityCompare;
+  std::set<Commodity, CommodityCompare> commods =
+      producer->ProducedCommodities();
+  std::set<Commodity, CommodityCompare>::iterator it;
+  for (it = commods.begin(); it != commods.end(); ++it) {
+    if (sign > 0) {
+      commod_producers_[it->name()].insert(producer);
+    } else {
+      commod_producers_[it->name()].erase(producer);
+    }
+    commod_capacity_[it->name()] += sign * producer->Capacity(*it);
+  }
+}
+
+double ManagerInst::Capacity(const std::string& commod) const {
+  std::map<std::string, double>::const_iterator it =
+      commod_capacity_.find(commod);
+  return it == commod_capacity_.end() ? 0 : it->second;
+}
+
+const std::set<cyclus::toolkit::CommodityProducer*>& ManagerInst::Producers(
+    const std::string& commod) const {
+  std::map<std::string, std::set<cyclus::toolkit::CommodityProducer*> >::
+      const_iterator it = commod_producers_.find(commod);
+  return it == commod_producers_.end() ? no_producers : it->second;
+}
+
+void ManagerInst::NotifyRegion_(cyclus::toolkit::CommodityProducer* producer,
+                                double sign) {
+  GrowthRegion* region = dynamic_cast<GrowthRegion*>(parent());
+  if (region != NULL)
+    region->ProducerNotify(this, producer, sign);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -90,15 +153,8 @@ void ManagerInst::WriteProducerInformation(
 }
 
 void ManagerInst::RecordPosition() {
-  std::string specification = this->spec();
-  context()
-      ->NewDatum("AgentPosition")
-      ->AddVal("Spec", specification)
-      ->AddVal("Prototype", this->prototype())
-      ->AddVal("AgentId", id())
-      ->AddVal("Latitude", latitude)
-      ->AddVal("Longitude", longitude)
-      ->Record();
+  CompactOutput::RecordPosition(this, latitude, longitude,
+                                 compact_output);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -1,6 +1,10 @@
 #ifndef CYCAMORE_SRC_MANAGER_INST_H_
 #define CYCAMORE_SRC_MANAGER_INST_H_
 
+#include <map>
+#include <set>
+#include <string>
+
 #include "cyclus.h"
 #include "cycamore_version.h"
 
@@ -39,6 +43,16 @@ class ManagerInst
   /// unregister a child
   virtual void DecomNotify(Agent* m);
 
+  /// returns the total capacity of the registered producers of a commodity.
+  /// This is kept as a running tally, so unlike TotalCapacity it does not
+  /// walk the producers.  Producer capacities are assumed not to change while
+  /// they are registered.
+  double Capacity(const std::string& commod) const;
+
+  /// returns the registered producers of a commodity
+  const std::set<cyclus::toolkit::CommodityProducer*>& Producers(
+      const std::string& commod) const;
+
   /// write information about a commodity producer to a stream
   /// @param producer the producer
   void WriteProducerInformation(cyclus::toolkit::CommodityProducer*
@@ -51,6 +65,15 @@ class ManagerInst
   /// unregister a child
   void Unregister_(cyclus::Agent* agent);
 
+  /// adds (sign = 1) or removes (sign = -1) a producer from the commodity
+  /// index and capacity tallies
+  void Index_(cyclus::toolkit::CommodityProducer* producer, double sign);
+
+  /// lets a parent GrowthRegion update its supply tally for a producer that
+  /// was registered (sign = 1) or unregistered (sign = -1)
+  void NotifyRegion_(cyclus::toolkit::CommodityProducer* producer,
+                     double sign);
+
   #pragma cyclus var { \
     "tooltip": "producer facility prototypes",                          \
     "uilabel": "Producer Prototype List",                               \
@@ -77,8 +100,30 @@ class ManagerInst
   }
   double longitude;
 
+  #pragma cyclus var { \
+    "default": "", \
+    "uilabel": "Compact Output Mode", \
+    "userlevel": 10, \
+    "doc": "Output mode for this agent's position. Empty or 'off' " \
+           "writes the regular tables. 'batches' writes the position to " \
+           "AgentPositionCompact, as does 'runs'.", \
+  }
+  std::string compact_output;
+
   cyclus::toolkit::Position coordinates;
 
+  /// registered children that are commodity producers
+  std::map<cyclus::Agent*, cyclus::toolkit::CommodityProducer*> children_;
+
+  /// registered producers and their total capacity by commodity
+  std::map<std::string, std::set<cyclus::toolkit::CommodityProducer*> >
+      commod_producers_;
+  std::map<std::string, double> commod_capacity_;
+
+  /// clones of the listed prototypes by name, or NULL for prototypes that are
+  /// not commodity producers, so that each is created and cast only once
+  std::map<std::string, cyclus::toolkit::CommodityProducer*> proto_producers_;
+
   /// Records an agent's latitude and longitude to the output db
   void RecordPosition();
 };
@@ -53,6 +53,25 @@ TEST_F(ManagerInstTests, productioncapacity) {
   EXPECT_EQ(src_inst->TotalCapacity(commodity), 0);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(ManagerInstTests, CommodityIndex) {
+  EXPECT_DOUBLE_EQ(0, src_inst->Capacity("commod"));
+  EXPECT_TRUE(src_inst->Producers("commod").empty());
+
+  src_inst->BuildNotify(producer);
+  src_inst->BuildNotify(producer);
+  EXPECT_DOUBLE_EQ(capacity, src_inst->Capacity("commod"));
+  EXPECT_DOUBLE_EQ(0, src_inst->Capacity("other"));
+  ASSERT_EQ(1, src_inst->Producers("commod").size());
+  EXPECT_EQ(producer, *src_inst->Producers("commod").begin());
+
+  src_inst->DecomNotify(producer);
+  src_inst->DecomNotify(producer);
+  EXPECT_DOUBLE_EQ(0, src_inst->Capacity("commod"));
+  EXPECT_TRUE(src_inst->Producers("commod").empty());
+  EXPECT_DOUBLE_EQ(0, src_inst->TotalCapacity(commodity));
+}
+
 // required to get functionality in cyclus agent unit tests library
 #ifndef CYCLUS_AGENT_TESTS_CONNECTED
 int ConnectAgentTests();
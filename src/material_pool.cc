@@ -0,0 +1,27 @@
+#include "material_pool.h"
+
+namespace cycamore {
+
+cyclus::Material::Ptr MaterialPool::Get(double qty,
+                                        cyclus::Composition::Ptr c) {
+  cyclus::Material::Ptr& m = mats_[std::make_pair(c->id(), qty)];
+  if (!m) {
+    m = cyclus::Material::CreateUntracked(qty, c);
+  }
+  return m;
+}
+
+cyclus::Material::Ptr MaterialPool::Find(int key, double qty) const {
+  std::map<Key, cyclus::Material::Ptr>::const_iterator it =
+      mats_.find(std::make_pair(key, qty));
+  if (it == mats_.end()) {
+    return cyclus::Material::Ptr();
+  }
+  return it->second;
+}
+
+void MaterialPool::Put(int key, double qty, cyclus::Material::Ptr m) {
+  mats_[std::make_pair(key, qty)] = m;
+}
+
+}  // namespace cycamore
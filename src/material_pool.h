@@ -0,0 +1,48 @@
+#ifndef CYCAMORE_SRC_MATERIAL_POOL_H_
+#define CYCAMORE_SRC_MATERIAL_POOL_H_
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cyclus.h"
+
+namespace cycamore {
+
+/// MaterialPool hands out the throwaway untracked materials that agents put
+/// on the exchange as bid offers and request targets.  Materials are keyed by
+/// composition (or any other integer key the caller picks) and quantity, so
+/// all bids or requests of a time step that need the same material share one
+/// object instead of each allocating its own.  Pooled materials are shared and
+/// must never be modified.  Owners call Reset once the exchange is over (in
+/// Tock), so a pool holds at most one time step's worth of materials.
+class MaterialPool {
+ public:
+  /// Returns an untracked material of qty kg with composition c, creating it
+  /// on first use in the time step.
+  cyclus::Material::Ptr Get(double qty, cyclus::Composition::Ptr c);
+
+  /// Returns the material stored under key for qty kg, or a null pointer if
+  /// there is none.
+  cyclus::Material::Ptr Find(int key, double qty) const;
+
+  /// Stores the untracked material m under key for qty kg.  The material's
+  /// own quantity may differ slightly, e.g. when it was built by absorbing
+  /// several pieces.
+  void Put(int key, double qty, cyclus::Material::Ptr m);
+
+  /// Drops all pooled materials.
+  void Reset() { mats_.clear(); }
+
+  /// Returns the number of pooled materials.
+  int size() const { return mats_.size(); }
+
+ private:
+  typedef std::pair<int, double> Key;
+  std::map<Key, cyclus::Material::Ptr> mats_;
+};
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_MATERIAL_POOL_H_
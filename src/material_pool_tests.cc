@@ -0,0 +1,51 @@
+#include "material_pool.h"
+
+#include <gtest/gtest.h>
+
+using cyclus::CompMap;
+using cyclus::Composition;
+using cyclus::Material;
+
+namespace cycamore {
+
+namespace {
+
+Composition::Ptr Uranium(double assay) {
+  CompMap m;
+  m[922350000] = assay;
+  m[922380000] = 1 - assay;
+  return Composition::CreateFromMass(m);
+}
+
+}  // namespace
+
+TEST(MaterialPoolTests, Get) {
+  MaterialPool pool;
+  Composition::Ptr leu = Uranium(0.04);
+  Composition::Ptr heu = Uranium(0.9);
+
+  Material::Ptr m = pool.Get(10, leu);
+  EXPECT_DOUBLE_EQ(10, m->quantity());
+  EXPECT_EQ(leu, m->comp());
+  EXPECT_EQ(m, pool.Get(10, leu));
+  EXPECT_NE(m, pool.Get(5, leu));
+  EXPECT_NE(m, pool.Get(10, heu));
+  EXPECT_EQ(3, pool.size());
+
+  pool.Reset();
+  EXPECT_EQ(0, pool.size());
+  EXPECT_NE(m, pool.Get(10, leu));
+}
+
+TEST(MaterialPoolTests, FindPut) {
+  MaterialPool pool;
+  Material::Ptr m = Material::CreateUntracked(3, Uranium(0.04));
+
+  EXPECT_FALSE(pool.Find(7, 3));
+  pool.Put(7, 3, m);
+  EXPECT_EQ(m, pool.Find(7, 3));
+  EXPECT_FALSE(pool.Find(7, 4));
+  EXPECT_FALSE(pool.Find(8, 3));
+}
+
+}  // namespace cycamore
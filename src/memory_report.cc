@@ -0,0 +1,69 @@
+#include "memory_report.h"
+
+#include <set>
+#include <utility>
+
+namespace cycamore {
+
+namespace {
+
+// Approximate heap footprint of a reference-counted object's control block
+// and of one node of a nuclide map, including the allocator's bookkeeping.
+const double kRefCountBytes = 4 * sizeof(void*);
+const double kMapNodeBytes =
+    4 * sizeof(void*) + sizeof(std::pair<const int, double>);
+
+}  // namespace
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+bool MemoryReport::Due(cyclus::Context* ctx, int period) {
+  if (period <= 0) {
+    return false;
+  }
+  int t = ctx->time();
+  return t % period == 0 || t >= ctx->sim_info().duration - 1;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+MemoryReport::Usage MemoryReport::Measure(
+    const std::vector<cyclus::Resource::Ptr>& rs) {
+  Usage u;
+  std::set<int> seen;
+  for (int i = 0; i < rs.size(); ++i) {
+    u.resources++;
+    u.quantity += rs[i]->quantity();
+
+    cyclus::Material::Ptr m =
+        boost::dynamic_pointer_cast<cyclus::Material>(rs[i]);
+    if (!m) {
+      u.bytes += sizeof(cyclus::Product) + kRefCountBytes;
+      continue;
+    }
+    u.bytes += sizeof(cyclus::Material) + kRefCountBytes;
+
+    cyclus::Composition::Ptr c = m->comp();
+    if (seen.insert(c->id()).second) {
+      u.comps++;
+      u.bytes += sizeof(cyclus::Composition) + kRefCountBytes +
+                 2 * c->atom().size() * kMapNodeBytes;
+    }
+  }
+  return u;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void MemoryReport::Record(cyclus::Agent* agent, const std::string& buffer,
+                          const Usage& u) {
+  agent->context()
+      ->NewDatum("AgentMemory")
+      ->AddVal("AgentId", agent->id())
+      ->AddVal("Time", agent->context()->time())
+      ->AddVal("Buffer", buffer)
+      ->AddVal("Resources", u.resources)
+      ->AddVal("Compositions", u.comps)
+      ->AddVal("Quantity", u.quantity)
+      ->AddVal("Bytes", u.bytes)
+      ->Record();
+}
+
+}  // namespace cycamore
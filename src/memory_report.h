@@ -0,0 +1,69 @@
+#ifndef CYCAMORE_SRC_MEMORY_REPORT_H_
+#define CYCAMORE_SRC_MEMORY_REPORT_H_
+
+#include <string>
+#include <vector>
+
+#include "cyclus.h"
+
+namespace cycamore {
+
+/// MemoryReport accounts for the resources held in the inventory buffers of
+/// the cycamore facilities.  For each buffer it counts the resource objects,
+/// the distinct compositions among them and an estimate of the bytes they
+/// take up.  This makes it possible to find the facilities behind the memory
+/// growth of long fleet simulations from the output database alone.
+///
+/// Reporting is turned on per facility by its memory_report_period state
+/// variable, the reporting period in time steps, so it is part of the
+/// simulation input.  It is off for a period of 0, the default.  When it is
+/// on, the facility writes one AgentMemory row (AgentId, Time, Buffer,
+/// Resources, Compositions, Quantity, Bytes) per buffer at the end of its
+/// Tock.  This happens every period steps and on the last step of the
+/// simulation.
+///
+/// The byte estimate covers the resource objects with their reference
+/// counts, plus each distinct composition with its atom and mass maps.
+/// Compositions shared between buffers are counted once in every buffer
+/// holding them, so the sum over buffers is an upper bound.  Finding the
+/// map size may compute the atom fractions of a composition that so far
+/// only had mass fractions.
+class MemoryReport {
+ public:
+  /// The accounted usage of one set of resources.
+  struct Usage {
+    Usage() : resources(0), comps(0), quantity(0), bytes(0) {}
+    int resources;
+    int comps;
+    double quantity;
+    double bytes;
+  };
+
+  /// Returns true if a report with the given period is due at the current
+  /// time step of ctx.  A period of 0 or less is never due.
+  static bool Due(cyclus::Context* ctx, int period);
+
+  /// Returns the accounted usage of rs.
+  static Usage Measure(const std::vector<cyclus::Resource::Ptr>& rs);
+
+  /// Records the usage of buf as the buffer named buffer of agent.  ResBufs
+  /// cannot be walked in place, so the resources are popped and pushed back
+  /// in the same order.
+  template <class T>
+  static void Record(cyclus::Agent* agent, const std::string& buffer,
+                     cyclus::toolkit::ResBuf<T>& buf) {
+    std::vector<typename T::Ptr> held = buf.PopN(buf.count());
+    buf.Push(held);
+    Record(agent, buffer,
+           Measure(std::vector<cyclus::Resource::Ptr>(held.begin(),
+                                                      held.end())));
+  }
+
+  /// Records u as the usage of the buffer named buffer of agent.
+  static void Record(cyclus::Agent* agent, const std::string& buffer,
+                     const Usage& u);
+};
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_MEMORY_REPORT_H_
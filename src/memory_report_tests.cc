@@ -0,0 +1,75 @@
+#include "memory_report.h"
+
+#include <gtest/gtest.h>
+#include "cyclus.h"
+
+using cyclus::CompMap;
+using cyclus::Composition;
+using cyclus::Cond;
+using cyclus::Material;
+using cyclus::QueryResult;
+using cyclus::Resource;
+
+namespace cycamore {
+
+namespace {
+
+Composition::Ptr Uranium(double assay) {
+  CompMap m;
+  m[922350000] = assay;
+  m[922380000] = 1 - assay;
+  return Composition::CreateFromMass(m);
+}
+
+}  // namespace
+
+TEST(MemoryReportTests, Measure) {
+  Composition::Ptr leu = Uranium(0.04);
+  std::vector<Resource::Ptr> rs;
+  rs.push_back(Material::CreateUntracked(1, leu));
+  rs.push_back(Material::CreateUntracked(2, leu));
+
+  MemoryReport::Usage one = MemoryReport::Measure(rs);
+  EXPECT_EQ(2, one.resources);
+  EXPECT_EQ(1, one.comps);
+  EXPECT_DOUBLE_EQ(3, one.quantity);
+  EXPECT_LT(0, one.bytes);
+
+  rs.push_back(Material::CreateUntracked(4, Uranium(0.9)));
+  MemoryReport::Usage two = MemoryReport::Measure(rs);
+  EXPECT_EQ(3, two.resources);
+  EXPECT_EQ(2, two.comps);
+  EXPECT_DOUBLE_EQ(7, two.quantity);
+  EXPECT_LT(one.bytes, two.bytes);
+
+  EXPECT_EQ(0, MemoryReport::Measure(std::vector<Resource::Ptr>()).resources);
+}
+
+TEST(MemoryReportTests, SinkTable) {
+  std::string config =
+      "<in_commods><val>commod</val></in_commods>"
+      "<capacity>1</capacity>"
+      "<inventory_mode>keep</inventory_mode>"
+      "<memory_report_period>2</memory_report_period>";
+
+  int simdur = 5;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Sink"), config, simdur);
+  sim.AddSource("commod").capacity(1).Finalize();
+  int id = sim.Run();
+
+  // every second step and the last one, with one material per step so far
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  conds.push_back(Cond("Buffer", "==", std::string("inventory")));
+  QueryResult qr = sim.db().Query("AgentMemory", &conds);
+  ASSERT_EQ(3, qr.rows.size());
+  for (int i = 0; i < qr.rows.size(); ++i) {
+    int t = qr.GetVal<int>("Time", i);
+    EXPECT_EQ(0, t % 2);
+    EXPECT_EQ(t + 1, qr.GetVal<int>("Resources", i));
+    EXPECT_DOUBLE_EQ(t + 1, qr.GetVal<double>("Quantity", i));
+    EXPECT_LT(0, qr.GetVal<double>("Bytes", i));
+  }
+}
+
+}  // namespace cycamore
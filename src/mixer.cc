@@ -1,18 +1,48 @@
+#include <cstdlib>
 #include <sstream>
 
+#include "buffer_squash.h"
+#include "compact_output.h"
+#include "memory_report.h"
 #include "mixer.h"
 
 namespace cycamore {
 
+namespace {
+
+const char kStreamPrefix[] = "in_stream_";
+
+// Returns the inventory name used to persist stream i.
+std::string StreamName(int i) { return kStreamPrefix + std::to_string(i); }
+
+// Returns the stream index persisted under name or -1 if name is not a
+// stream inventory name.
+int StreamIndex(const std::string& name) {
+  std::string prefix(kStreamPrefix);
+  if (name.compare(0, prefix.size(), prefix) != 0 ||
+      name.size() == prefix.size()) {
+    return -1;
+  }
+  return std::atoi(name.c_str() + prefix.size());
+}
+
+}  // namespace
+
 Mixer::Mixer(cyclus::Context* ctx) 
     : cyclus::Facility(ctx), 
       throughput(0),
+      min_request_qty(0),
+      request_resume_qty(0),
+      squash_buffers(false),
       latitude(0.0),
       longitude(0.0),
-      coordinates(latitude, longitude) {
+      compact_output(""),
+      profile_phases(false),
+      memory_report_period(0),
+      coordinates(latitude, longitude),
+      profile_(this, profile_phases) {
   cyclus::Warn<cyclus::EXPERIMENTAL_WARNING>(
       "the Mixer archetype is experimental");
-  RecordPosition();
 }
 
 cyclus::Inventories Mixer::SnapshotInv() {
@@ -24,22 +54,29 @@ cyclus::Inventories Mixer::SnapshotInv() {
   invs["output-inv-name"] = output.PopNRes(output.count());
   output.Push(invs["output-inv-name"]);
 
-  std::map<std::string, cyclus::toolkit::ResBuf<cyclus::Material> >::iterator
-      it;
-  for (it = streambufs.begin(); it != streambufs.end(); ++it) {
-    invs[it->first] = it->second.PopNRes(it->second.count());
-    it->second.Push(invs[it->first]);
+  for (int i = 0; i < streambufs.size(); ++i) {
+    std::string name = StreamName(i);
+    invs[name] = streambufs[i].PopNRes(streambufs[i].count());
+    streambufs[i].Push(invs[name]);
   }
   return invs;
 }
 
 void Mixer::InitInv(cyclus::Inventories& inv) {
-  inv["output-inv-name"] = output.PopNRes(output.count());
-  output.Push(inv["output-inv-name"]);
-
   cyclus::Inventories::iterator it;
   for (it = inv.begin(); it != inv.end(); ++it) {
-    streambufs[it->first].Push(it->second);
+    if (it->first == "output-inv-name") {
+      output.Push(it->second);
+      continue;
+    }
+    int i = StreamIndex(it->first);
+    if (i < 0) {
+      continue;
+    }
+    if (i >= streambufs.size()) {
+      streambufs.resize(i + 1);
+    }
+    streambufs[i].Push(it->second);
   }
 }
 
@@ -51,14 +88,16 @@ void Mixer::EnterNotify() {
   in_commods.clear();
 
   // initialisation internal variable
+  if (streambufs.size() < streams_.size()) {
+    streambufs.resize(streams_.size());
+  }
   for (int i = 0; i < streams_.size(); i++) {
     mixing_ratios.push_back(streams_[i].first.first);
     in_buf_sizes.push_back(streams_[i].first.second);
 
-    std::string name = "in_stream_" + std::to_string(i);
     double cap = in_buf_sizes[i];
     if (cap >= 0) {
-      streambufs[name].capacity(cap);
+      streambufs[i].capacity(cap);
     }
     in_commods.push_back(streams_[i].second);
   }
@@ -93,16 +132,16 @@ void Mixer::EnterNotify() {
   }
 
   sell_policy.Init(this, &output, "output").Set(out_commod).Start();
+  RecordPosition();
 }
 
 void Mixer::Tick() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::TICK);
   if (output.quantity() < output.capacity()) {
     double tgt_qty = output.space();
 
     for (int i = 0; i < mixing_ratios.size(); i++) {
-      std::string name = "in_stream_" + std::to_string(i);
-      tgt_qty =
-          std::min(tgt_qty, streambufs[name].quantity() / mixing_ratios[i]);
+      tgt_qty = std::min(tgt_qty, streambufs[i].quantity() / mixing_ratios[i]);
     }
 
     tgt_qty = std::min(tgt_qty, throughput);
@@ -110,13 +149,12 @@ void Mixer::Tick() {
     if (tgt_qty > 0) {
       cyclus::Material::Ptr m;
       for (int i = 0; i < mixing_ratios.size(); i++) {
-        std::string name = "in_stream_" + std::to_string(i);
         double pop_qty = mixing_ratios[i] * tgt_qty;
         if (i == 0) {
-          m = streambufs[name].Pop(pop_qty, cyclus::eps_rsrc());
+          m = streambufs[i].Pop(pop_qty, cyclus::eps_rsrc());
         } else {
           cyclus::Material::Ptr m_ =
-              streambufs[name].Pop(pop_qty, cyclus::eps_rsrc());
+              streambufs[i].Pop(pop_qty, cyclus::eps_rsrc());
           m->Absorb(m_);
         }
       }
@@ -125,21 +163,47 @@ void Mixer::Tick() {
   }
 }
 
+void Mixer::Tock() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::TOCK);
+  if (squash_buffers) {
+    for (int i = 0; i < streambufs.size(); i++) {
+      SquashRuns(streambufs[i]);
+    }
+    SquashRuns(output);
+  }
+  if (MemoryReport::Due(context(), memory_report_period)) {
+    for (int i = 0; i < streambufs.size(); i++) {
+      MemoryReport::Record(this, "streambufs[" + std::to_string(i) + "]",
+                           streambufs[i]);
+    }
+    MemoryReport::Record(this, "output", output);
+  }
+}
+
+void Mixer::Decommission() {
+  profile_.Flush();
+  cyclus::Facility::Decommission();
+}
+
 std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr>
 Mixer::GetMatlRequests() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_REQUESTS);
   using cyclus::RequestPortfolio;
 
   std::set<RequestPortfolio<cyclus::Material>::Ptr> ports;
-  
+  req_gates_.resize(streambufs.size());
+
   for (int i = 0; i < in_commods.size(); i++) {
-    std::string name = "in_stream_" + std::to_string(i);
-    
-    if (streambufs[name].space() > cyclus::eps_rsrc()) {
+    double space = streambufs[i].space();
+    if (!req_gates_[i].Open(space, min_request_qty, request_resume_qty)) {
+      continue;
+    }
+    if (space > cyclus::eps_rsrc()) {
       RequestPortfolio<cyclus::Material>::Ptr port(
           new RequestPortfolio<cyclus::Material>());
 
       cyclus::Material::Ptr m;
-      m = cyclus::NewBlankMaterial(streambufs[name].space());
+      m = cyclus::NewBlankMaterial(streambufs[i].space());
 
       std::vector<cyclus::Request<cyclus::Material>*> reqs;
       
@@ -148,18 +212,20 @@ Mixer::GetMatlRequests() {
         std::string commod = it->first;
         double pref = it->second;
         reqs.push_back(port->AddRequest(m, this, commod , pref, false));
-        req_inventories_[reqs.back()] = name;
+        req_inventories_[reqs.back()] = i;
       }
       port->AddMutualReqs(reqs);  
       ports.insert(port);
     }
   }
+  profile_.Count(ports);
   return ports;
 }
 
 void Mixer::AcceptMatlTrades(
     const std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                                 cyclus::Material::Ptr> >& responses) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::ACCEPT_MATL_TRADES);
   std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                         cyclus::Material::Ptr> >::const_iterator trade;
 
@@ -167,36 +233,20 @@ void Mixer::AcceptMatlTrades(
     cyclus::Request<cyclus::Material>* req = trade->first.request;
     cyclus::Material::Ptr m = trade->second;
 
-    std::string name = req_inventories_[req];
-    bool assigned = false;
-    std::map<std::string, cyclus::toolkit::ResBuf<cyclus::Material> >::iterator
-        it;
-
-    for (it = streambufs.begin(); it != streambufs.end(); it++) {
-      if (name == it->first) {
-        it->second.Push(m);
-        assigned = true;
-        break;
-      }
-    }
-    if (!assigned) {
+    std::unordered_map<cyclus::Request<cyclus::Material>*, int>::iterator it =
+        req_inventories_.find(req);
+    if (it == req_inventories_.end()) {
       throw cyclus::ValueError("cycamore::Mixer was overmatched on requests");
     }
+    streambufs[it->second].Push(m);
   }
 
   req_inventories_.clear();
 }
 
 void Mixer::RecordPosition() {
-  std::string specification = spec();
-  context()
-      ->NewDatum("AgentPosition")
-      ->AddVal("Spec", specification)
-      ->AddVal("Prototype", this->prototype())
-      ->AddVal("AgentId", id())
-      ->AddVal("Latitude", latitude)
-      ->AddVal("Longitude", longitude)
-      ->Record();
+  CompactOutput::RecordPosition(this, latitude, longitude,
+                                 compact_output);
 }
 
 extern "C" cyclus::Agent* ConstructMixer(cyclus::Context* ctx) {
@@ -2,8 +2,12 @@
 #define CYCAMORE_SRC_MIXER_H_
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 #include "cycamore_version.h"
 #include "cyclus.h"
+#include "phase_profile.h"
+#include "request_gate.h"
 
 namespace cycamore {
 
@@ -25,14 +29,16 @@ class Mixer
     }
 
   friend class MixerTest;
+  friend class MixerBench;
 
  public:
   Mixer(cyclus::Context* ctx);
   virtual ~Mixer(){};
 
   virtual void Tick();
-  virtual void Tock(){};
+  virtual void Tock();
   virtual void EnterNotify();
+  virtual void Decommission();
 
   virtual void AcceptMatlTrades(
       const std::vector<std::pair<cyclus::Trade<cyclus::Material>,
@@ -71,8 +77,9 @@ class Mixer
   std::vector<double> mixing_ratios;
 
   // custom SnapshotInv and InitInv and EnterNotify are used to persist this
-  // state var.
-  std::map<std::string, cyclus::toolkit::ResBuf<cyclus::Material> > streambufs;
+  // state var. Buffers are indexed by stream number; the "in_stream_<i>"
+  // names are only used as inventory names when persisting.
+  std::vector<cyclus::toolkit::ResBuf<cyclus::Material> > streambufs;
 
 
 #pragma cyclus var {                                                 \
@@ -105,9 +112,49 @@ class Mixer
   }
   double throughput;
 
+#pragma cyclus var { \
+    "default": 0.0, \
+    "doc": "Smallest quantity the mixer requests for a stream. A stream" \
+           " buffer with less free space than this stops requesting until" \
+           " it has room for request_resume_qty.", \
+    "uilabel": "Minimum Stream Request", \
+    "units": "kg", \
+    "userlevel": 10, \
+  }
+  double min_request_qty;
+
+#pragma cyclus var { \
+    "default": 0.0, \
+    "doc": "Free space a stream buffer needs before requests resume once" \
+           " they have stopped. Values below min_request_qty resume at" \
+           " min_request_qty.", \
+    "uilabel": "Stream Request Resume Quantity", \
+    "units": "kg", \
+    "userlevel": 10, \
+  }
+  double request_resume_qty;
+
+#pragma cyclus var { \
+    "default": False, \
+    "doc": "If true, each run of adjacent materials with the same" \
+           " composition in an inventory buffer is merged into one material" \
+           " at the end of every time step, instead of keeping every received" \
+           " or separated lot.  Merged lots stay parents of the merged" \
+           " material, and the buffer order is kept, so quantities drawn" \
+           " from the buffers are unchanged.  Fewer materials make snapshots" \
+           " and restarts cheaper.", \
+    "uilabel": "Squash Inventory Buffers", \
+    "userlevel": 10, \
+  }
+  bool squash_buffers;
+
+  // one request gate per stream - no need to be a state var
+  std::vector<RequestGate> req_gates_;
+
   // intra-time-step state - no need to be a state var
-  // map<request, inventory name>
-  std::map<cyclus::Request<cyclus::Material>*, std::string> req_inventories_;
+  // map<request, stream index>
+  std::unordered_map<cyclus::Request<cyclus::Material>*, int>
+      req_inventories_;
 
   //// A policy for sending material
   cyclus::toolkit::MatlSellPolicy sell_policy;
@@ -129,10 +176,46 @@ class Mixer
   }
   double longitude;
 
+  #pragma cyclus var { \
+    "default": "", \
+    "uilabel": "Compact Output Mode", \
+    "userlevel": 10, \
+    "doc": "Output mode for this agent's position. Empty or 'off' " \
+           "writes the regular tables. 'batches' writes the position to " \
+           "AgentPositionCompact, as does 'runs'.", \
+  }
+  std::string compact_output;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Profile Phases", \
+    "userlevel": 10, \
+    "doc": "If true, this facility records its call counts, wall time " \
+           "and bids or requests emitted for each phase of the time step. " \
+           "The whole-simulation totals are written to the AgentPhaseTimes " \
+           "table at the end of the simulation or when the facility is " \
+           "decommissioned.", \
+  }
+  bool profile_phases;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Memory Report Period", \
+    "userlevel": 10, \
+    "units": "time steps", \
+    "doc": "If positive, this facility writes one AgentMemory row per " \
+           "inventory buffer, with its resource and composition counts, " \
+           "quantity and estimated bytes, every memory_report_period time " \
+           "steps and on the last time step. 0 turns the report off.", \
+  }
+  int memory_report_period;
+
   cyclus::toolkit::Position coordinates;
 
   /// Records an agent's latitude and longitude to the output db
   void RecordPosition();
+
+  PhaseProfile profile_;
 };
 
 }  // namespace cycamore
@@ -96,6 +96,10 @@ class MixerTest : public ::testing::Test {
     mf_facility_->throughput = thpt;
   }
 
+  void SetSquashBuffers(bool squash) {
+    mf_facility_->squash_buffers = squash;
+  }
+
   void SetIn_stream(t_instream streams) {
     mf_facility_->streams_ = streams;
     
@@ -147,9 +151,11 @@ class MixerTest : public ::testing::Test {
   }
 
   void SetInputInv(std::vector<cyclus::Material::Ptr> mat) {
+    if (mf_facility_->streambufs.size() < mat.size()) {
+      mf_facility_->streambufs.resize(mat.size());
+    }
     for (int i = 0; i < mat.size(); i++) {
-      std::string name = "in_stream_" + std::to_string(i);
-      mf_facility_->streambufs[name].Push(mat[i]);
+      mf_facility_->streambufs[i].Push(mat[i]);
     }
   }
 
@@ -167,7 +173,7 @@ class MixerTest : public ::testing::Test {
 
   InvBuffer* GetOutPutBuffer() { return &mf_facility_->output; }
 
-  std::map<std::string, InvBuffer> GetStreamBuffer() {
+  std::vector<InvBuffer> GetStreamBuffer() {
     return mf_facility_->streambufs;
   }
 };
@@ -228,6 +234,60 @@ TEST_F(MixerTest, StreamRatio) {
                            << sum;
 }
 
+// Check that stream buffers persist under their in_stream_<i> names
+TEST_F(MixerTest, InventoryRoundTrip) {
+  using cyclus::Material;
+
+  std::vector<Material::Ptr> mat;
+  mat.push_back(Material::CreateUntracked(in_cap[0], c_natu()));
+  mat.push_back(Material::CreateUntracked(in_cap[1], c_pustream()));
+  mat.push_back(Material::CreateUntracked(in_cap[2], c_uox()));
+  SetInputInv(mat);
+  GetOutPutBuffer()->Push(Material::CreateUntracked(1, c_uox()));
+
+  cyclus::Inventories invs = mf_facility_->SnapshotInv();
+  EXPECT_EQ(4, invs.size());
+  EXPECT_EQ(1, invs.count("in_stream_2"));
+
+  delete mf_facility_;
+  mf_facility_ = new Mixer(tc_.get());
+  mf_facility_->InitInv(invs);
+
+  std::vector<InvBuffer> streambuf = GetStreamBuffer();
+  ASSERT_EQ(3, streambuf.size());
+  for (int i = 0; i < 3; i++) {
+    EXPECT_DOUBLE_EQ(in_cap[i], streambuf[i].quantity());
+  }
+  EXPECT_DOUBLE_EQ(1, GetOutPutBuffer()->quantity());
+}
+
+// Check that squashed buffers merge adjacent lots of one composition on Tock
+TEST_F(MixerTest, SquashedBuffers) {
+  using cyclus::Material;
+
+  cyclus::Composition::Ptr uox = c_uox();
+  InvBuffer* output = GetOutPutBuffer();
+  output->Push(Material::CreateUntracked(1, uox));
+  output->Push(Material::CreateUntracked(2, uox));
+  output->Push(Material::CreateUntracked(3, c_natu()));
+
+  // off by default
+  mf_facility_->Tock();
+  EXPECT_EQ(3, output->count());
+
+  SetSquashBuffers(true);
+  mf_facility_->Tock();
+  ASSERT_EQ(2, output->count());
+  EXPECT_DOUBLE_EQ(6, output->quantity());
+
+  // snapshots are plain copies of the buffers
+  cyclus::Inventories invs = mf_facility_->SnapshotInv();
+  ASSERT_EQ(2, invs["output-inv-name"].size());
+  EXPECT_DOUBLE_EQ(3, invs["output-inv-name"][0]->quantity());
+  EXPECT_DOUBLE_EQ(3, invs["output-inv-name"][1]->quantity());
+  EXPECT_EQ(2, output->count());
+}
+
 // Check the correct mixing cyclus::Composition
 TEST_F(MixerTest, MixingComposition) {
   using cyclus::Material;
@@ -299,13 +359,12 @@ TEST_F(MixerTest, Throughput) {
     cap.push_back(in_cap[i] - 0.5 * in_frac[i]);
   }
 
-  std::map<std::string, InvBuffer> streambuf = GetStreamBuffer();
+  std::vector<InvBuffer> streambuf = GetStreamBuffer();
 
   for (int i = 0; i < in_coms.size(); i++) {
-    std::string name = "in_stream_" + std::to_string(i);
     double buf_size = in_cap[i];
     double buf_ratio = in_frac[i];
-    double buf_inv = streambuf[name].quantity();
+    double buf_inv = streambuf[i].quantity();
 
     // checking that each input buf was reduce of the correct amount
     // (constrained by the throughput"
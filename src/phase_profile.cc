@@ -0,0 +1,113 @@
+#include "phase_profile.h"
+
+#include <chrono>
+
+namespace cycamore {
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+PhaseProfile::Scope::Scope(PhaseProfile* p, Phase ph)
+    : p_(p->enabled() ? p : NULL), ph_(ph), start_(0) {
+  if (p_ != NULL) {
+    start_ = PhaseProfile::Now();
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+PhaseProfile::Scope::~Scope() {
+  if (p_ == NULL) {
+    return;
+  }
+  Totals& t = p_->totals_[ph_];
+  t.calls++;
+  t.seconds += PhaseProfile::Now() - start_;
+  p_->dirty_ = true;
+
+  cyclus::Context* ctx = p_->agent_->context();
+  if (ph_ == TOCK && ctx->time() >= ctx->sim_info().duration - 1) {
+    p_->Flush();
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+PhaseProfile::PhaseProfile(cyclus::Agent* agent, const bool& enabled)
+    : agent_(agent), enabled_(&enabled), dirty_(false) {}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+const char* PhaseProfile::Name(Phase ph) {
+  switch (ph) {
+    case TICK:
+      return "Tick";
+    case TOCK:
+      return "Tock";
+    case GET_MATL_REQUESTS:
+      return "GetMatlRequests";
+    case GET_MATL_BIDS:
+      return "GetMatlBids";
+    case GET_MATL_TRADES:
+      return "GetMatlTrades";
+    case ACCEPT_MATL_TRADES:
+      return "AcceptMatlTrades";
+    case ADJUST_MATL_PREFS:
+      return "AdjustMatlPrefs";
+    default:
+      return "Unknown";
+  }
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void PhaseProfile::Count(
+    const std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr>& ports) {
+  if (!enabled()) {
+    return;
+  }
+  std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr>::const_iterator it;
+  for (it = ports.begin(); it != ports.end(); ++it) {
+    totals_[GET_MATL_REQUESTS].offers += (*it)->requests().size();
+  }
+  dirty_ = true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void PhaseProfile::Count(
+    const std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr>& ports) {
+  if (!enabled()) {
+    return;
+  }
+  std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr>::const_iterator it;
+  for (it = ports.begin(); it != ports.end(); ++it) {
+    totals_[GET_MATL_BIDS].offers += (*it)->bids().size();
+  }
+  dirty_ = true;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void PhaseProfile::Flush() {
+  if (!dirty_) {
+    return;
+  }
+  cyclus::Context* ctx = agent_->context();
+  for (int i = 0; i < N_PHASES; ++i) {
+    Totals& t = totals_[i];
+    if (t.calls == 0 && t.offers == 0) {
+      continue;
+    }
+    ctx->NewDatum("AgentPhaseTimes")
+        ->AddVal("AgentId", agent_->id())
+        ->AddVal("Phase", std::string(Name(static_cast<Phase>(i))))
+        ->AddVal("Calls", t.calls)
+        ->AddVal("WallTime", t.seconds)
+        ->AddVal("Offers", t.offers)
+        ->Record();
+    t = Totals();
+  }
+  dirty_ = false;
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+double PhaseProfile::Now() {
+  using std::chrono::steady_clock;
+  using std::chrono::duration;
+  return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+}  // namespace cycamore
@@ -0,0 +1,94 @@
+#ifndef CYCAMORE_SRC_PHASE_PROFILE_H_
+#define CYCAMORE_SRC_PHASE_PROFILE_H_
+
+#include <set>
+#include <string>
+
+#include "cyclus.h"
+
+namespace cycamore {
+
+/// PhaseProfile is a lightweight per-agent instrumentation layer shared by the
+/// cycamore facilities.  For each phase of the time step it accumulates the
+/// number of calls, the wall time spent and the number of bids or requests
+/// emitted.
+///
+/// Profiling is turned on per agent by the owner's profile_phases state
+/// variable, so it is part of the simulation input.  When it is off a phase
+/// scope costs a single branch and nothing is recorded.  When it is on, the
+/// whole-simulation totals are written to the AgentPhaseTimes table, one row
+/// per agent and active phase, at the end of the last time step or when the
+/// owner calls Flush (e.g. on decommissioning).
+///
+/// Profiling never creates resources or otherwise touches simulation state,
+/// so a profiled run writes the same tables as an unprofiled one apart from
+/// AgentPhaseTimes.
+class PhaseProfile {
+ public:
+  /// The instrumented agent phases.
+  enum Phase {
+    TICK = 0,
+    TOCK,
+    GET_MATL_REQUESTS,
+    GET_MATL_BIDS,
+    GET_MATL_TRADES,
+    ACCEPT_MATL_TRADES,
+    ADJUST_MATL_PREFS,
+    N_PHASES
+  };
+
+  /// Times one call of a phase for its own lifetime.  The scope that closes the TOCK phase of the last time
+  /// step also flushes the profile, since it ends the simulation.
+  class Scope {
+   public:
+    Scope(PhaseProfile* p, Phase ph);
+    ~Scope();
+
+   private:
+    PhaseProfile* p_;
+    Phase ph_;
+    double start_;
+  };
+
+  /// Profiles agent while enabled, which is usually one of its state
+  /// variables, is true.
+  PhaseProfile(cyclus::Agent* agent, const bool& enabled);
+
+  /// Returns true if profiling is turned on for the agent.
+  bool enabled() const { return *enabled_; }
+
+  /// Returns the name recorded in the output table for ph.
+  static const char* Name(Phase ph);
+
+  /// Adds the requests in ports to the GET_MATL_REQUESTS totals.
+  void Count(
+      const std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr>& ports);
+
+  /// Adds the bids in ports to the GET_MATL_BIDS totals.
+  void Count(
+      const std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr>& ports);
+
+  /// Records a row for every phase called since the last flush and resets the
+  /// totals.
+  void Flush();
+
+ private:
+  struct Totals {
+    Totals() : calls(0), seconds(0), offers(0) {}
+    int calls;
+    double seconds;
+    int offers;
+  };
+
+  /// Returns a monotonic wall clock reading in seconds.
+  static double Now();
+
+  cyclus::Agent* agent_;
+  const bool* enabled_;
+  Totals totals_[N_PHASES];
+  bool dirty_;
+};
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_PHASE_PROFILE_H_
@@ -0,0 +1,62 @@
+#include "phase_profile.h"
+
+#include <gtest/gtest.h>
+#include "cyclus.h"
+
+using cyclus::Cond;
+using cyclus::QueryResult;
+
+namespace cycamore {
+
+TEST(PhaseProfileTests, Names) {
+  EXPECT_EQ(std::string("Tick"), PhaseProfile::Name(PhaseProfile::TICK));
+  EXPECT_EQ(std::string("AdjustMatlPrefs"),
+            PhaseProfile::Name(PhaseProfile::ADJUST_MATL_PREFS));
+}
+
+TEST(PhaseProfileTests, SinkTable) {
+  std::string config =
+      "<in_commods><val>commod</val></in_commods>"
+      "<capacity>1</capacity>"
+      "<profile_phases>1</profile_phases>";
+
+  int simdur = 3;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Sink"), config, simdur);
+  sim.AddSource("commod").capacity(1).Finalize();
+  int id = sim.Run();
+
+  // one row per phase with the whole-simulation totals
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  conds.push_back(Cond("Phase", "==", std::string("AcceptMatlTrades")));
+  QueryResult qr = sim.db().Query("AgentPhaseTimes", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(simdur, qr.GetVal<int>("Calls"));
+  EXPECT_LE(0, qr.GetVal<double>("WallTime"));
+
+  conds[1] = Cond("Phase", "==", std::string("GetMatlRequests"));
+  qr = sim.db().Query("AgentPhaseTimes", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(simdur, qr.GetVal<int>("Offers"));
+
+  conds[1] = Cond("Phase", "==", std::string("Tock"));
+  qr = sim.db().Query("AgentPhaseTimes", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(simdur, qr.GetVal<int>("Calls"));
+}
+
+TEST(PhaseProfileTests, Disabled) {
+  std::string config =
+      "<in_commods><val>commod</val></in_commods>"
+      "<capacity>1</capacity>";
+
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Sink"), config, 3);
+  sim.AddSource("commod").capacity(1).Finalize();
+  int id = sim.Run();
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("AgentId", "==", id));
+  EXPECT_THROW(sim.db().Query("AgentPhaseTimes", &conds), std::exception);
+}
+
+}  // namespace cycamore
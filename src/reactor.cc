@@ -1,5 +1,7 @@
 #include "reactor.h"
 
+#include "memory_report.h"
+
 using cyclus::Material;
 using cyclus::Composition;
 using cyclus::toolkit::ResBuf;
@@ -17,15 +19,28 @@ Reactor::Reactor(cyclus::Context* ctx)
       n_assem_core(0),
       n_assem_spent(0),
       n_assem_fresh(0),
+      spent_bid_strategy("covering"),
+      spent_bid_limit(1),
+      batch_requests(false),
+      reactor_events("string"),
       cycle_time(0),
       refuel_time(0),
       cycle_step(0),
       power_cap(0),
       power_name("power"),
       discharged(false),
+      n_spent_indexed_(0),
+      pref_change_cursor_(0),
+      recipe_change_cursor_(0),
+      schedules_sorted_(false),
       latitude(0.0),
       longitude(0.0),
-      coordinates(latitude, longitude) {}
+      compact_output(""),
+      profile_phases(false),
+      memory_report_period(0),
+      coordinates(latitude, longitude),
+      profile_(this, profile_phases),
+      power_series_(this, "Power", compact_output) {}
 
 
 #pragma cyclus def clone cycamore::Reactor
@@ -45,6 +60,7 @@ Reactor::Reactor(cyclus::Context* ctx)
 void Reactor::InitFrom(Reactor* m) {
   #pragma cyclus impl initfromcopy cycamore::Reactor
   cyclus::toolkit::CommodityProducer::Copy(m);
+  RebuildResIndexCache_();
 }
 
 void Reactor::InitFrom(cyclus::QueryableBackend* b) {
@@ -53,10 +69,14 @@ void Reactor::InitFrom(cyclus::QueryableBackend* b) {
   namespace tk = cyclus::toolkit;
   tk::CommodityProducer::Add(tk::Commodity(power_name),
                              tk::CommodInfo(power_cap, power_cap));
+  RebuildResIndexCache_();
 }
 
 void Reactor::EnterNotify() {
   cyclus::Facility::EnterNotify();
+  incommod_indexes_.clear();
+  RebuildResIndexCache_();
+  schedules_sorted_ = false;
 
   // If the user ommitted fuel_prefs, we set it to zeros for each fuel
   // type.  Without this segfaults could occur - yuck.
@@ -93,6 +113,21 @@ void Reactor::EnterNotify() {
        << " pref_change_values vals, expected " << n << "\n";
   }
 
+  if (spent_bid_strategy != "covering" && spent_bid_strategy != "oldest_n" &&
+      spent_bid_strategy != "lot") {
+    ss << "prototype '" << prototype() << "' has unknown spent_bid_strategy '"
+       << spent_bid_strategy << "', expected covering, oldest_n or lot\n";
+  }
+  if (reactor_events != "string" && reactor_events != "typed" &&
+      reactor_events != "both") {
+    ss << "prototype '" << prototype() << "' has unknown reactor_events '"
+       << reactor_events << "', expected string, typed or both\n";
+  }
+  if (spent_bid_strategy == "oldest_n" && spent_bid_limit < 1) {
+    ss << "prototype '" << prototype() << "' has spent_bid_limit "
+       << spent_bid_limit << ", expected at least 1\n";
+  }
+
   if (ss.str().size() > 0) {
     throw cyclus::ValueError(ss.str());
   }
@@ -103,7 +138,15 @@ bool Reactor::CheckDecommissionCondition() {
   return core.count() == 0 && spent.count() == 0;
 }
 
+void Reactor::Decommission() {
+  FlushEvents();
+  power_series_.Flush();
+  profile_.Flush();
+  cyclus::Facility::Decommission();
+}
+
 void Reactor::Tick() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::TICK);
   // The following code must go in the Tick so they fire on the time step
   // following the cycle_step update - allowing for the all reactor events to
   // occur and be recorded on the "beginning" of a time step.  Another reason
@@ -112,28 +155,24 @@ void Reactor::Tick() {
   // chance to occur after the discharge on this same time step.
 
   if (retired()) {
-    Record("RETIRED", "");
+    Record(EVENT_RETIRED);
 
     if (context()->time() == exit_time() + 1) { // only need to transmute once
       Transmute(ceil(static_cast<double>(n_assem_core) / 2.0));
     }
-    while (core.count() > 0) {
-      if (!Discharge()) {
-        break;
-      }
+    if (core.count() > 0) {
+      Discharge(core.count());
     }
     // in case a cycle lands exactly on our last time step, we will need to
     // burn a batch from fresh inventory on this time step.  When retired,
     // this batch also needs to be discharged to spent fuel inventory.
-    while (fresh.count() > 0 && spent.space() >= assem_size) {
-      spent.Push(fresh.Pop());
-    }
+    RetireFresh();
     return;
   }
 
   if (cycle_step == cycle_time) {
     Transmute();
-    Record("CYCLE_END", "");
+    Record(EVENT_CYCLE_END);
   }
 
   if (cycle_step >= cycle_time && !discharged) {
@@ -144,42 +183,76 @@ void Reactor::Tick() {
   }
 
   int t = context()->time();
+  if (!schedules_sorted_) {
+    SortSchedules();
+  }
 
   // update preferences
-  for (int i = 0; i < pref_change_times.size(); i++) {
-    int change_t = pref_change_times[i];
-    if (t != change_t) {
-      continue;
+  for (; pref_change_cursor_ < pref_change_order_.size();
+       pref_change_cursor_++) {
+    int i = pref_change_order_[pref_change_cursor_];
+    if (pref_change_times[i] > t) {
+      break;
+    } else if (pref_change_times[i] < t) {
+      continue;  // changes only apply on their exact time step
     }
 
-    std::string incommod = pref_change_commods[i];
-    for (int j = 0; j < fuel_incommods.size(); j++) {
-      if (fuel_incommods[j] == incommod) {
-        fuel_prefs[j] = pref_change_values[i];
-        break;
-      }
+    int j = incommod_index(pref_change_commods[i]);
+    if (j >= 0) {
+      fuel_prefs[j] = pref_change_values[i];
     }
   }
 
   // update recipes
-  for (int i = 0; i < recipe_change_times.size(); i++) {
-    int change_t = recipe_change_times[i];
-    if (t != change_t) {
-      continue;
+  for (; recipe_change_cursor_ < recipe_change_order_.size();
+       recipe_change_cursor_++) {
+    int i = recipe_change_order_[recipe_change_cursor_];
+    if (recipe_change_times[i] > t) {
+      break;
+    } else if (recipe_change_times[i] < t) {
+      continue;  // changes only apply on their exact time step
     }
 
-    std::string incommod = recipe_change_commods[i];
-    for (int j = 0; j < fuel_incommods.size(); j++) {
-      if (fuel_incommods[j] == incommod) {
-        fuel_inrecipes[j] = recipe_change_in[i];
-        fuel_outrecipes[j] = recipe_change_out[i];
-        break;
-      }
+    int j = incommod_index(recipe_change_commods[i]);
+    if (j >= 0) {
+      fuel_inrecipes[j] = recipe_change_in[i];
+      fuel_outrecipes[j] = recipe_change_out[i];
+      inrecipe_h_.clear();
     }
   }
 }
 
+namespace {
+
+// Returns the indices of times ordered by time, keeping the given order for
+// equal times.
+struct TimeOrder {
+  explicit TimeOrder(const std::vector<int>& times) : times_(times) {}
+  bool operator()(int i, int j) const { return times_[i] < times_[j]; }
+  const std::vector<int>& times_;
+};
+
+std::vector<int> SortedByTime(const std::vector<int>& times) {
+  std::vector<int> order(times.size());
+  for (int i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), TimeOrder(times));
+  return order;
+}
+
+}  // namespace
+
+void Reactor::SortSchedules() {
+  pref_change_order_ = SortedByTime(pref_change_times);
+  recipe_change_order_ = SortedByTime(recipe_change_times);
+  pref_change_cursor_ = 0;
+  recipe_change_cursor_ = 0;
+  schedules_sorted_ = true;
+}
+
 std::set<cyclus::RequestPortfolio<Material>::Ptr> Reactor::GetMatlRequests() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_REQUESTS);
   using cyclus::RequestPortfolio;
 
   std::set<RequestPortfolio<Material>::Ptr> ports;
@@ -207,21 +280,59 @@ std::set<cyclus::RequestPortfolio<Material>::Ptr> Reactor::GetMatlRequests() {
     return ports;
   }
 
+  if (batch_requests) {
+    // partial assemblies held back from earlier trades only need topping up
+    std::map<std::string, double> held;
+    MatVec parts = partial.PopN(partial.count());
+    partial.Push(parts);
+    for (int i = 0; i < parts.size(); i++) {
+      held[fuel_incommod(parts[i])] += parts[i]->quantity();
+    }
+
+    double max_qty = 0;
+    RequestPortfolio<Material>::Ptr port(new RequestPortfolio<Material>());
+    std::vector<Request<Material>*> mreqs;
+    for (int j = 0; j < fuel_incommods.size(); j++) {
+      double qty = n_assem_order * assem_size - held[fuel_incommods[j]];
+      if (qty <= cyclus::eps_rsrc()) {
+        continue;
+      }
+      max_qty = std::max(max_qty, qty);
+      m = target_pool_.Get(qty, fuel_incomp(j));
+      mreqs.push_back(port->AddRequest(m, this, fuel_incommods[j],
+                                       fuel_prefs[j]));
+    }
+    if (mreqs.empty()) {
+      return ports;
+    }
+    port->AddMutualReqs(mreqs);
+    port->AddConstraint(cyclus::CapacityConstraint<Material>(max_qty));
+    ports.insert(port);
+    profile_.Count(ports);
+    return ports;
+  }
+
+  // every assembly order is identical, so the target materials are built
+  // once per fuel and shared by all of the portfolios
+  std::vector<Material::Ptr> targets;
+  for (int j = 0; j < fuel_incommods.size(); j++) {
+    targets.push_back(target_pool_.Get(assem_size, fuel_incomp(j)));
+  }
+
   for (int i = 0; i < n_assem_order; i++) {
     RequestPortfolio<Material>::Ptr port(new RequestPortfolio<Material>());
     std::vector<Request<Material>*> mreqs;
     for (int j = 0; j < fuel_incommods.size(); j++) {
-      std::string commod = fuel_incommods[j];
-      double pref = fuel_prefs[j];
-      Composition::Ptr recipe = context()->GetRecipe(fuel_inrecipes[j]);
-      m = Material::CreateUntracked(assem_size, recipe);
-      Request<Material>* r = port->AddRequest(m, this, commod, pref, true);
+      Request<Material>* r = port->AddRequest(targets[j], this,
+                                              fuel_incommods[j], fuel_prefs[j],
+                                              true);
       mreqs.push_back(r);
     }
     port->AddMutualReqs(mreqs);
     ports.insert(port);
   }
 
+  profile_.Count(ports);
   return ports;
 }
 
@@ -229,36 +340,67 @@ void Reactor::GetMatlTrades(
     const std::vector<cyclus::Trade<Material> >& trades,
     std::vector<std::pair<cyclus::Trade<Material>, Material::Ptr> >&
         responses) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_TRADES);
   using cyclus::Trade;
 
   std::map<std::string, MatVec> mats = PopSpent();
   for (int i = 0; i < trades.size(); i++) {
     std::string commod = trades[i].request->commodity();
-    Material::Ptr m = mats[commod].back();
-    mats[commod].pop_back();
+    Material::Ptr m;
+    if (spent_bid_strategy == "lot") {
+      m = PopLot(mats[commod], trades[i].bid->offer()->comp(), trades[i].amt);
+    } else {
+      m = mats[commod].back();
+      mats[commod].pop_back();
+      unindex_res(m);
+    }
     cyclus::toolkit::RecordTimeSeries<double>("UsedFuel", this, m->quantity());
     responses.push_back(std::make_pair(trades[i], m));
-    res_indexes.erase(m->obj_id());
   }
   PushSpent(mats);  // return leftovers back to spent buffer
 }
 
 void Reactor::AcceptMatlTrades(const std::vector<
     std::pair<cyclus::Trade<Material>, Material::Ptr> >& responses) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::ACCEPT_MATL_TRADES);
   std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                         cyclus::Material::Ptr> >::const_iterator trade;
 
-  std::stringstream ss;
-  int nload = std::min((int)responses.size(), n_assem_core - core.count());
-  if (nload > 0) {
-    ss << nload << " assemblies";
-    Record("LOAD", ss.str());
-  }
-
+  // batched requests can be filled with several assemblies at once, and
+  // with fuel that only tops up or starts an assembly
+  std::vector<std::pair<std::string, Material::Ptr> > assems;
   for (trade = responses.begin(); trade != responses.end(); ++trade) {
     std::string commod = trade->first.request->commodity();
     Material::Ptr m = trade->second;
-    index_res(m, commod);
+    if (!batch_requests) {
+      assems.push_back(std::make_pair(commod, m));
+      continue;
+    }
+
+    Material::Ptr held = TakePartial_(commod);
+    if (held) {
+      held->Absorb(m);
+      m = held;
+    }
+    while (m->quantity() > assem_size + cyclus::eps_rsrc()) {
+      assems.push_back(std::make_pair(commod, m->ExtractQty(assem_size)));
+    }
+    if (m->quantity() >= assem_size - cyclus::eps_rsrc()) {
+      assems.push_back(std::make_pair(commod, m));
+    } else {
+      index_res(m, commod);
+      partial.Push(m);
+    }
+  }
+
+  int nload = std::min((int)assems.size(), n_assem_core - core.count());
+  if (nload > 0) {
+    Record(EVENT_LOAD, nload);
+  }
+
+  for (int i = 0; i < assems.size(); i++) {
+    Material::Ptr m = assems[i].second;
+    index_res(m, assems[i].first);
 
     if (core.count() < n_assem_core) {
       core.Push(m);
@@ -270,12 +412,13 @@ void Reactor::AcceptMatlTrades(const std::vector<
 
 std::set<cyclus::BidPortfolio<Material>::Ptr> Reactor::GetMatlBids(
     cyclus::CommodMap<Material>::type& commod_requests) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_BIDS);
   using cyclus::BidPortfolio;
 
   std::set<BidPortfolio<Material>::Ptr> ports;
-
-  bool gotmats = false;
-  std::map<std::string, MatVec> all_mats;
+  if (spent.count() == 0) {
+    return ports;  // nothing to offer - most reactors mid-cycle
+  }
 
   if (uniq_outcommods_.empty()) {
     for (int i = 0; i < fuel_outcommods.size(); i++) {
@@ -289,21 +432,47 @@ std::set<cyclus::BidPortfolio<Material>::Ptr> Reactor::GetMatlBids(
     std::vector<Request<Material>*>& reqs = commod_requests[commod];
     if (reqs.size() == 0) {
       continue;
-    } else if (!gotmats) {
-      all_mats = PeekSpent();
     }
 
-    MatVec mats = all_mats[commod];
-    if (mats.size() == 0) {
+    const std::map<std::string, MatVec>& all_mats = PeekSpent();
+    std::map<std::string, MatVec>::const_iterator found = all_mats.find(commod);
+    if (found == all_mats.end() || found->second.size() == 0) {
       continue;
     }
+    const MatVec& mats = found->second;
 
     BidPortfolio<Material>::Ptr port(new BidPortfolio<Material>());
 
-    for (int j = 0; j < reqs.size(); j++) {
+    if (spent_bid_strategy == "lot") {
+      // one offer per spent composition, oldest lot first
+      std::vector<Composition::Ptr> comps;
+      std::map<Composition::Ptr, double> lots;
+      for (int k = 0; k < mats.size(); k++) {
+        Composition::Ptr c = mats[k]->comp();
+        if (lots.count(c) == 0) {
+          comps.push_back(c);
+        }
+        lots[c] += mats[k]->quantity();
+      }
+      for (int k = 0; k < comps.size(); k++) {
+        Material::Ptr lot = Material::CreateUntracked(lots[comps[k]], comps[k]);
+        for (int j = 0; j < reqs.size(); j++) {
+          port->AddBid(reqs[j], lot, this);
+        }
+      }
+    }
+
+    int nbid = mats.size();
+    if (spent_bid_strategy == "lot") {
+      nbid = 0;
+    } else if (spent_bid_strategy == "oldest_n") {
+      nbid = std::min(nbid, spent_bid_limit);
+    }
+
+    for (int j = 0; j < reqs.size() && nbid > 0; j++) {
       Request<Material>* req = reqs[j];
       double tot_bid = 0;
-      for (int k = 0; k < mats.size(); k++) {
+      for (int k = 0; k < nbid; k++) {
         Material::Ptr m = mats[k];
         tot_bid += m->quantity();
         port->AddBid(req, m, this, true);
@@ -322,11 +491,21 @@ std::set<cyclus::BidPortfolio<Material>::Ptr> Reactor::GetMatlBids(
     ports.insert(port);
   }
 
+  profile_.Count(ports);
   return ports;
 }
 
 void Reactor::Tock() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::TOCK);
+  target_pool_.Reset();
+  if (MemoryReport::Due(context(), memory_report_period)) {
+    MemoryReport::Record(this, "fresh", fresh);
+    MemoryReport::Record(this, "core", core);
+    MemoryReport::Record(this, "spent", spent);
+    MemoryReport::Record(this, "partial", partial);
+  }
   if (retired()) {
+    FlushEvents();
     return;
   }
 
@@ -336,14 +515,16 @@ void Reactor::Tock() {
   }
 
   if (cycle_step == 0 && core.count() == n_assem_core) {
-    Record("CYCLE_START", "");
+    Record(EVENT_CYCLE_START);
   }
 
+  double power = 0;
   if (cycle_step >= 0 && cycle_step < cycle_time &&
       core.count() == n_assem_core) {
-    cyclus::toolkit::RecordTimeSeries<cyclus::toolkit::POWER>(this, power_cap);
-  } else {
-    cyclus::toolkit::RecordTimeSeries<cyclus::toolkit::POWER>(this, 0);
+    power = power_cap;
+  }
+  if (!power_series_.Record(power)) {
+    cyclus::toolkit::RecordTimeSeries<cyclus::toolkit::POWER>(this, power);
   }
 
   // "if" prevents starting cycle after initial deployment until core is full
@@ -351,6 +532,9 @@ void Reactor::Tock() {
   if (cycle_step > 0 || core.count() == n_assem_core) {
     cycle_step++;
   }
+
+  // everything recorded this time step (including trades) happened by now
+  FlushEvents();
 }
 
 void Reactor::Transmute() { Transmute(n_assem_batch); }
@@ -363,39 +547,119 @@ void Reactor::Transmute(int n_assem) {
     core.Push(core.PopN(core.count() - old.size()));
   }
 
-  std::stringstream ss;
-  ss << old.size() << " assemblies";
-  Record("TRANSMUTE", ss.str());
+  Record(EVENT_TRANSMUTE, old.size());
 
+  // one outrecipe composition per fuel slot for the whole batch
+  std::vector<Composition::Ptr> outcomps(fuel_outrecipes.size());
   for (int i = 0; i < old.size(); i++) {
-    old[i]->Transmute(context()->GetRecipe(fuel_outrecipe(old[i])));
+    int j = fuel_index(old[i]);
+    if (j >= fuel_outrecipes.size()) {
+      throw KeyError("cycamore::Reactor - no outrecipe for material object");
+    }
+    if (!outcomps[j]) {
+      outcomps[j] = fuel_outcomp(j);
+    }
+    old[i]->Transmute(outcomps[j]);
+  }
+}
+
+const std::map<std::string, MatVec>& Reactor::PeekSpent() {
+  if (n_spent_indexed_ != spent.count()) {
+    spent_index_.clear();
+    MatVec mats = spent.PopN(spent.count());
+    spent.Push(mats);
+    for (int i = 0; i < mats.size(); i++) {
+      spent_index_[fuel_outcommod(mats[i])].push_back(mats[i]);
+    }
+    n_spent_indexed_ = mats.size();
   }
+  return spent_index_;
 }
 
-std::map<std::string, MatVec> Reactor::PeekSpent() {
-  std::map<std::string, MatVec> mapped;
-  MatVec mats = spent.PopN(spent.count());
+void Reactor::PushToSpent(const MatVec& mats) {
+  bool synced = n_spent_indexed_ == spent.count();
   spent.Push(mats);
+  if (!synced) {
+    return;  // PeekSpent rebuilds the whole index
+  }
   for (int i = 0; i < mats.size(); i++) {
-    std::string commod = fuel_outcommod(mats[i]);
-    mapped[commod].push_back(mats[i]);
+    spent_index_[fuel_outcommod(mats[i])].push_back(mats[i]);
   }
-  return mapped;
+  n_spent_indexed_ += mats.size();
 }
 
-bool Reactor::Discharge() {
-  int npop = std::min(n_assem_batch, core.count());
-  if (n_assem_spent - spent.count() < npop) {
-    Record("DISCHARGE", "failed");
-    return false;  // not enough room in spent buffer
+Material::Ptr Reactor::PopLot(MatVec& mats, Composition::Ptr comp,
+                              double qty) {
+  // mats holds the oldest assemblies at the back (see PopSpent)
+  Material::Ptr lot;
+  for (int k = mats.size() - 1; k >= 0 && qty > cyclus::eps_rsrc(); k--) {
+    if (mats[k]->comp() != comp) {
+      continue;
+    }
+    Material::Ptr m = mats[k];
+    if (m->quantity() > qty + cyclus::eps_rsrc()) {
+      // only the last assembly of a lot is ever split
+      m = m->ExtractQty(qty);
+    } else {
+      mats.erase(mats.begin() + k);
+      unindex_res(m);
+    }
+    qty -= m->quantity();
+    if (lot) {
+      lot->Absorb(m);
+    } else {
+      lot = m;
+    }
   }
 
-  std::stringstream ss;
-  ss << npop << " assemblies";
-  Record("DISCHARGE", ss.str());
+  if (!lot) {
+    throw ValueError(
+        "cycamore::Reactor - no spent fuel left to fill a lot trade");
+  }
+  return lot;
+}
 
-  spent.Push(core.PopN(npop));
-  return true;
+bool Reactor::Discharge() { return Discharge(1); }
+
+bool Reactor::Discharge(int n_batches) {
+  int ncore = core.count();
+  int room = n_assem_spent - spent.count();
+  int n = 0;
+  bool ok = true;
+  for (int b = 0; b < n_batches && (b == 0 || n < ncore); b++) {
+    int npop = std::min(n_assem_batch, ncore - n);
+    if (room - n < npop) {
+      Record(EVENT_DISCHARGE_FAILED);
+      ok = false;  // not enough room in spent buffer
+      break;
+    }
+    Record(EVENT_DISCHARGE, npop);
+    n += npop;
+  }
+
+  if (n > 0) {
+    PushToSpent(core.PopN(n));
+  }
+  return ok;
+}
+
+void Reactor::RetireFresh() {
+  if (fresh.count() == 0) {
+    return;
+  }
+
+  MatVec mats = fresh.PopN(fresh.count());
+  double space = spent.space();
+  int n = 0;
+  while (n < mats.size() && space >= assem_size) {
+    space -= mats[n]->quantity();
+    n++;
+  }
+
+  PushToSpent(MatVec(mats.begin(), mats.begin() + n));
+  if (n < mats.size()) {
+    fresh.Push(MatVec(mats.begin() + n, mats.end()));
+  }
 }
 
 void Reactor::Load() {
@@ -404,46 +668,94 @@ void Reactor::Load() {
     return;
   }
 
-  std::stringstream ss;
-  ss << n << " assemblies";
-  Record("LOAD", ss.str());
+  Record(EVENT_LOAD, n);
   core.Push(fresh.PopN(n));
 }
 
-std::string Reactor::fuel_incommod(Material::Ptr m) {
-  int i = res_indexes[m->obj_id()];
+int Reactor::fuel_index(Material::Ptr m) {
+  std::unordered_map<int, int>::const_iterator it =
+      res_index_cache_.find(m->obj_id());
+  if (it == res_index_cache_.end()) {
+    // materials never indexed map to the first fuel
+    return 0;
+  }
+  return it->second;
+}
+
+int Reactor::incommod_index(const std::string& incommod) {
+  if (incommod_indexes_.empty()) {
+    for (int i = 0; i < fuel_incommods.size(); i++) {
+      // insert doesn't overwrite, so the first matching slot wins
+      incommod_indexes_.insert(std::make_pair(fuel_incommods[i], i));
+    }
+  }
+  std::unordered_map<std::string, int>::const_iterator it =
+      incommod_indexes_.find(incommod);
+  if (it == incommod_indexes_.end()) {
+    return -1;
+  }
+  return it->second;
+}
+
+const std::string& Reactor::fuel_incommod(Material::Ptr m) {
+  int i = fuel_index(m);
   if (i >= fuel_incommods.size()) {
     throw KeyError("cycamore::Reactor - no incommod for material object");
   }
   return fuel_incommods[i];
 }
 
-std::string Reactor::fuel_outcommod(Material::Ptr m) {
-  int i = res_indexes[m->obj_id()];
+const std::string& Reactor::fuel_outcommod(Material::Ptr m) {
+  int i = fuel_index(m);
   if (i >= fuel_outcommods.size()) {
     throw KeyError("cycamore::Reactor - no outcommod for material object");
   }
   return fuel_outcommods[i];
 }
 
-std::string Reactor::fuel_inrecipe(Material::Ptr m) {
-  int i = res_indexes[m->obj_id()];
+const std::string& Reactor::fuel_inrecipe(Material::Ptr m) {
+  int i = fuel_index(m);
   if (i >= fuel_inrecipes.size()) {
     throw KeyError("cycamore::Reactor - no inrecipe for material object");
   }
   return fuel_inrecipes[i];
 }
 
-std::string Reactor::fuel_outrecipe(Material::Ptr m) {
-  int i = res_indexes[m->obj_id()];
+const std::string& Reactor::fuel_outrecipe(Material::Ptr m) {
+  int i = fuel_index(m);
   if (i >= fuel_outrecipes.size()) {
     throw KeyError("cycamore::Reactor - no outrecipe for material object");
   }
   return fuel_outrecipes[i];
 }
 
+Composition::Ptr Reactor::fuel_incomp(int j) {
+  SyncRecipes_();
+  return recipes_.Get(inrecipe_h_[j]);
+}
+
+Composition::Ptr Reactor::fuel_outcomp(int j) {
+  SyncRecipes_();
+  return recipes_.Get(outrecipe_h_[j]);
+}
+
+void Reactor::SyncRecipes_() {
+  if (inrecipe_h_.size() == fuel_inrecipes.size() &&
+      outrecipe_h_.size() == fuel_outrecipes.size()) {
+    return;
+  }
+  inrecipe_h_.resize(fuel_inrecipes.size());
+  outrecipe_h_.resize(fuel_outrecipes.size());
+  for (int j = 0; j < fuel_inrecipes.size(); j++) {
+    inrecipe_h_[j] = recipes_.Intern(context(), fuel_inrecipes[j]);
+  }
+  for (int j = 0; j < fuel_outrecipes.size(); j++) {
+    outrecipe_h_[j] = recipes_.Intern(context(), fuel_outrecipes[j]);
+  }
+}
+
 double Reactor::fuel_pref(Material::Ptr m) {
-  int i = res_indexes[m->obj_id()];
+  int i = fuel_index(m);
   if (i >= fuel_prefs.size()) {
     return 0;
   }
@@ -451,23 +763,49 @@ double Reactor::fuel_pref(Material::Ptr m) {
 }
 
 void Reactor::index_res(cyclus::Resource::Ptr m, std::string incommod) {
-  for (int i = 0; i < fuel_incommods.size(); i++) {
-    if (fuel_incommods[i] == incommod) {
-      res_indexes[m->obj_id()] = i;
-      return;
+  int i = incommod_index(incommod);
+  if (i < 0) {
+    throw ValueError(
+        "cycamore::Reactor - received unsupported incommod material");
+  }
+  SetResIndex_(m->obj_id(), i);
+}
+
+Material::Ptr Reactor::TakePartial_(const std::string& incommod) {
+  Material::Ptr found;
+  MatVec parts = partial.PopN(partial.count());
+  for (int i = 0; i < parts.size(); i++) {
+    if (!found && fuel_incommod(parts[i]) == incommod) {
+      found = parts[i];
+    } else {
+      partial.Push(parts[i]);
     }
   }
-  throw ValueError(
-      "cycamore::Reactor - received unsupported incommod material");
+  return found;
 }
 
-std::map<std::string, MatVec> Reactor::PopSpent() {
-  MatVec mats = spent.PopN(spent.count());
-  std::map<std::string, MatVec> mapped;
-  for (int i = 0; i < mats.size(); i++) {
-    std::string commod = fuel_outcommod(mats[i]);
-    mapped[commod].push_back(mats[i]);
+void Reactor::unindex_res(cyclus::Resource::Ptr m) {
+  SetResIndex_(m->obj_id(), -1);
+}
+
+void Reactor::SetResIndex_(int obj_id, int i) {
+  if (i < 0) {
+    res_indexes.erase(obj_id);
+    res_index_cache_.erase(obj_id);
+  } else {
+    res_indexes[obj_id] = i;
+    res_index_cache_[obj_id] = i;
   }
+}
+
+void Reactor::RebuildResIndexCache_() {
+  res_index_cache_.clear();
+  res_index_cache_.insert(res_indexes.begin(), res_indexes.end());
+}
+
+std::map<std::string, MatVec> Reactor::PopSpent() {
+  std::map<std::string, MatVec> mapped = PeekSpent();
+  spent.PopN(spent.count());
 
   // needed so we trade away oldest assemblies first
   std::map<std::string, MatVec>::iterator it;
@@ -479,34 +817,62 @@ std::map<std::string, MatVec> Reactor::PopSpent() {
 }
 
 void Reactor::PushSpent(std::map<std::string, MatVec> leftover) {
+  spent_index_.clear();
+  n_spent_indexed_ = 0;
   std::map<std::string, MatVec>::iterator it;
   for (it = leftover.begin(); it != leftover.end(); ++it) {
     // undo reverse in PopSpent to make sure oldest assemblies come out first
     std::reverse(it->second.begin(), it->second.end());
-    spent.Push(it->second);
+    PushToSpent(it->second);
   }
 }
 
-void Reactor::Record(std::string name, std::string val) {
+void Reactor::Record(EventCode code, int n) {
+  if (reactor_events != "string") {
+    BufferedEvent e = {context()->time(), static_cast<int>(code), n};
+    event_buf_.push_back(e);
+  }
+  if (reactor_events == "typed") {
+    return;
+  }
+
+  static const char* names[] = {"RETIRED",   "CYCLE_START", "CYCLE_END",
+                                "TRANSMUTE", "DISCHARGE",   "DISCHARGE",
+                                "LOAD"};
+  std::string val;
+  if (code == EVENT_DISCHARGE_FAILED) {
+    val = "failed";
+  } else if (code == EVENT_TRANSMUTE || code == EVENT_DISCHARGE ||
+             code == EVENT_LOAD) {
+    std::stringstream ss;
+    ss << n << " assemblies";
+    val = ss.str();
+  }
   context()
       ->NewDatum("ReactorEvents")
       ->AddVal("AgentId", id())
       ->AddVal("Time", context()->time())
-      ->AddVal("Event", name)
+      ->AddVal("Event", std::string(names[code]))
       ->AddVal("Value", val)
       ->Record();
 }
 
+void Reactor::FlushEvents() {
+  for (int i = 0; i < event_buf_.size(); i++) {
+    context()
+        ->NewDatum("ReactorEventCodes")
+        ->AddVal("AgentId", id())
+        ->AddVal("Time", event_buf_[i].time)
+        ->AddVal("Event", event_buf_[i].code)
+        ->AddVal("NAssemblies", event_buf_[i].n)
+        ->Record();
+  }
+  event_buf_.clear();
+}
+
 void Reactor::RecordPosition() {
-  std::string specification = this->spec();
-  context()
-      ->NewDatum("AgentPosition")
-      ->AddVal("Spec", specification)
-      ->AddVal("Prototype", this->prototype())
-      ->AddVal("AgentId", id())
-      ->AddVal("Latitude", latitude)
-      ->AddVal("Longitude", longitude)
-      ->Record();
+  CompactOutput::RecordPosition(this, latitude, longitude,
+                                 compact_output);
 }
 
 extern "C" cyclus::Agent* ConstructReactor(cyclus::Context* ctx) {
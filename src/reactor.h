@@ -1,8 +1,14 @@
 #ifndef CYCAMORE_SRC_REACTOR_H_
 #define CYCAMORE_SRC_REACTOR_H_
 
+#include <unordered_map>
+
 #include "cyclus.h"
 #include "cycamore_version.h"
+#include "compact_output.h"
+#include "material_pool.h"
+#include "phase_profile.h"
+#include "recipe_cache.h"
 
 namespace cycamore {
 
@@ -106,6 +112,8 @@ class Reactor : public cyclus::Facility,
   "", \
 }
 
+  friend class ReactorBench;
+
  public:
   Reactor(cyclus::Context* ctx);
   virtual ~Reactor(){};
@@ -117,6 +125,9 @@ class Reactor : public cyclus::Facility,
   virtual void EnterNotify();
   virtual bool CheckDecommissionCondition();
 
+  /// Writes any buffered time series values before decommissioning.
+  virtual void Decommission();
+
   virtual void AcceptMatlTrades(const std::vector<std::pair<
       cyclus::Trade<cyclus::Material>, cyclus::Material::Ptr> >& responses);
 
@@ -134,12 +145,29 @@ class Reactor : public cyclus::Facility,
   #pragma cyclus decl
 
  private:
-  std::string fuel_incommod(cyclus::Material::Ptr m);
-  std::string fuel_outcommod(cyclus::Material::Ptr m);
-  std::string fuel_inrecipe(cyclus::Material::Ptr m);
-  std::string fuel_outrecipe(cyclus::Material::Ptr m);
+  const std::string& fuel_incommod(cyclus::Material::Ptr m);
+  const std::string& fuel_outcommod(cyclus::Material::Ptr m);
+  const std::string& fuel_inrecipe(cyclus::Material::Ptr m);
+  const std::string& fuel_outrecipe(cyclus::Material::Ptr m);
   double fuel_pref(cyclus::Material::Ptr m);
 
+  /// Returns the compositions of fuel j's in and out recipes through the
+  /// recipe handle cache.
+  cyclus::Composition::Ptr fuel_incomp(int j);
+  cyclus::Composition::Ptr fuel_outcomp(int j);
+
+  /// Interns the current fuel_inrecipes and fuel_outrecipes if their
+  /// handles are missing or were invalidated by a recipe change.
+  void SyncRecipes_();
+
+  /// Returns the fuel index (into fuel_incommods, fuel_outcommods, etc.) of a
+  /// material received by this reactor.
+  int fuel_index(cyclus::Material::Ptr m);
+
+  /// Returns the index of incommod in fuel_incommods or -1 if it isn't one of
+  /// this reactor's fuel commodities.
+  int incommod_index(const std::string& incommod);
+
   bool retired() {
     return exit_time() != -1 && context()->time() > exit_time();
   }
@@ -147,10 +175,35 @@ class Reactor : public cyclus::Facility,
   /// Store fuel info index for the given resource received on incommod.
   void index_res(cyclus::Resource::Ptr m, std::string incommod);
 
+  /// Forget the fuel info index of a resource that has left the reactor.
+  void unindex_res(cyclus::Resource::Ptr m);
+
+  /// Sets the fuel index of the resource with obj_id in both res_indexes and
+  /// its hashed mirror, or removes it from both if i is negative.
+  void SetResIndex_(int obj_id, int i);
+
+  /// Rebuilds the hashed mirror of res_indexes, e.g. after the state
+  /// variables were initialized from a copy or a database.
+  void RebuildResIndexCache_();
+
+  /// Removes and returns the partial assembly held for incommod, or a null
+  /// pointer if there is none.
+  cyclus::Material::Ptr TakePartial_(const std::string& incommod);
+
   /// Discharge a batch from the core if there is room in the spent fuel
   /// inventory.  Returns true if a batch was successfully discharged.
   bool Discharge();
 
+  /// Discharge up to n_batches batches from the core in a single buffer
+  /// transfer, stopping early when the core is empty or the spent fuel
+  /// inventory is full.  Events are recorded per batch as with Discharge.
+  /// Returns false if the transfer stopped on a full spent fuel inventory.
+  bool Discharge(int n_batches);
+
+  /// Moves as many fresh assemblies straight to the spent fuel inventory as
+  /// it has room for in a single buffer transfer.
+  void RetireFresh();
+
   /// Top up core inventory as much as possible.
   void Load();
 
@@ -162,8 +215,26 @@ class Reactor : public cyclus::Facility,
   /// fully burnt state as defined by their outrecipe.
   void Transmute(int n_assem);
 
-  /// Records a reactor event to the output db with the given name and note val.
-  void Record(std::string name, std::string val);
+  /// Integer codes used for the Event column of the ReactorEventCodes table.
+  enum EventCode {
+    EVENT_RETIRED = 0,
+    EVENT_CYCLE_START = 1,
+    EVENT_CYCLE_END = 2,
+    EVENT_TRANSMUTE = 3,
+    EVENT_DISCHARGE = 4,
+    EVENT_DISCHARGE_FAILED = 5,
+    EVENT_LOAD = 6,
+  };
+
+  /// Records a reactor event involving n assemblies (0 if not applicable).
+  /// Depending on reactor_events, the event is written to the string-valued
+  /// ReactorEvents table right away and/or buffered for the typed
+  /// ReactorEventCodes table.
+  void Record(EventCode code, int n = 0);
+
+  /// Writes the buffered typed events, each with the time step it happened
+  /// on.
+  void FlushEvents();
 
   /// Complement of PopSpent - must be called with all materials passed that
   /// were not traded away to other agents.
@@ -173,9 +244,23 @@ class Reactor : public cyclus::Facility,
   /// the spent fuel buffer.
   std::map<std::string, cyclus::toolkit::MatVec> PopSpent();
 
-  /// Returns all spent assemblies indexed by outcommod without removing them
-  /// from the spent fuel buffer.
-  std::map<std::string, cyclus::toolkit::MatVec> PeekSpent();
+  /// Returns all spent assemblies indexed by outcommod (oldest first) without
+  /// removing them from the spent fuel buffer.  The index is maintained
+  /// incrementally as assemblies enter and leave the spent fuel buffer.
+  const std::map<std::string, cyclus::toolkit::MatVec>& PeekSpent();
+
+  /// Sorts the pref and recipe change schedules by time and positions their
+  /// cursors at the first change at or after the current time.
+  void SortSchedules();
+
+  /// Pushes mats into the spent fuel buffer and the spent fuel index.
+  void PushToSpent(const cyclus::toolkit::MatVec& mats);
+
+  /// Removes the oldest assemblies with composition comp from mats (ordered
+  /// as returned by PopSpent) until qty is covered and returns them combined
+  /// into a single material.  The last assembly is split if needed.
+  cyclus::Material::Ptr PopLot(cyclus::toolkit::MatVec& mats,
+                               cyclus::Composition::Ptr comp, double qty);
 
   /////// fuel specifications /////////
   #pragma cyclus var { \
@@ -300,6 +385,59 @@ class Reactor : public cyclus::Facility,
   }
   int n_assem_spent;
 
+  #pragma cyclus var { \
+    "default": "covering", \
+    "uilabel": "Spent Fuel Bid Strategy", \
+    "userlevel": 10, \
+    "doc": "How spent fuel assemblies are bid against each request for an " \
+           "outcommod. 'covering' bids the oldest assemblies until the " \
+           "request quantity is covered. 'oldest_n' does the same but bids at " \
+           "most spent_bid_limit assemblies per request. 'lot' bids a single " \
+           "offer per request for each spent composition (i.e. each output " \
+           "recipe lot) and ships the oldest matching assemblies combined " \
+           "into one material, splitting the last assembly if the traded " \
+           "quantity requires it. In all cases the oldest assemblies are " \
+           "traded away first.", \
+  }
+  std::string spent_bid_strategy;
+
+  #pragma cyclus var { \
+    "default": 1, \
+    "uilabel": "Spent Fuel Bid Limit", \
+    "userlevel": 10, \
+    "units": "assemblies", \
+    "doc": "Maximum number of spent assemblies bid against a single request " \
+           "when spent_bid_strategy is 'oldest_n'.", \
+  }
+  int spent_bid_limit;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Batch Fresh Fuel Requests", \
+    "userlevel": 10, \
+    "doc": "If true, the assemblies ordered on a time step are requested as " \
+           "a single multi-assembly request per fuel incommod (with a " \
+           "quantity constraint on the total) rather than one request " \
+           "portfolio per assembly. Received fuel is split back into " \
+           "assem_size assemblies. Fuel short of a full assembly is held " \
+           "back per incommod and topped up by the next requests instead of " \
+           "being loaded as a short assembly.", \
+  }
+  bool batch_requests;
+
+  #pragma cyclus var { \
+    "default": "string", \
+    "uilabel": "Reactor Event Tables", \
+    "userlevel": 10, \
+    "doc": "Which tables reactor events are recorded to. 'string' writes the " \
+           "ReactorEvents table with event names and free-form values. " \
+           "'typed' writes the ReactorEventCodes table with integer event " \
+           "codes (0 RETIRED, 1 CYCLE_START, 2 CYCLE_END, 3 TRANSMUTE, " \
+           "4 DISCHARGE, 5 DISCHARGE_FAILED, 6 LOAD) and assembly counts, " \
+           "buffered and written once per time step. 'both' writes both.", \
+  }
+  std::string reactor_events;
+
    ///////// cycle params ///////////
   #pragma cyclus var { \
     "default": 18, \
@@ -380,6 +518,10 @@ class Reactor : public cyclus::Facility,
   cyclus::toolkit::ResBuf<cyclus::Material> core;
   #pragma cyclus var {"capacity": "n_assem_spent * assem_size"}
   cyclus::toolkit::ResBuf<cyclus::Material> spent;
+  // fuel received through batched requests that does not make up a full
+  // assembly yet, at most one material per incommod.
+  #pragma cyclus var {"capacity": "(n_assem_core + n_assem_fresh) * assem_size"}
+  cyclus::toolkit::ResBuf<cyclus::Material> partial;
 
 
   // should be hidden in ui (internal only). True if fuel has already been
@@ -396,6 +538,47 @@ class Reactor : public cyclus::Facility,
   }
   std::map<int, int> res_indexes;
 
+  // Hashed mirror of res_indexes used for lookups, and the fuel index of each
+  // incommod.  The mirror is rebuilt when the agent is initialized or enters
+  // the simulation and kept in step by SetResIndex_, so no need to persist.
+  std::unordered_map<int, int> res_index_cache_;
+  std::unordered_map<std::string, int> incommod_indexes_;
+
+  // Spent assemblies indexed by outcommod in oldest-first order along with
+  // the number of assemblies indexed.  Rebuilt on demand whenever the count
+  // disagrees with the spent buffer (e.g. after a restart) and no need to
+  // persist.
+  std::map<std::string, cyclus::toolkit::MatVec> spent_index_;
+  int n_spent_indexed_;
+
+  // Indices of the pref and recipe change schedules in time order and the
+  // position of the next unapplied change in each, so Tick only looks at
+  // changes that are due.  Rebuilt on the first Tick after entering the
+  // simulation (or a restart) and no need to persist.
+  std::vector<int> pref_change_order_;
+  std::vector<int> recipe_change_order_;
+  int pref_change_cursor_;
+  int recipe_change_cursor_;
+  bool schedules_sorted_;
+
+  // Handles into recipes_ of each fuel's in and out recipe.  Cleared when a
+  // recipe change fires and rebuilt by SyncRecipes_ on first use, so no need
+  // to persist.
+  RecipeCache recipes_;
+  std::vector<int> inrecipe_h_;
+  std::vector<int> outrecipe_h_;
+
+  // A typed event waiting to be written by FlushEvents.
+  struct BufferedEvent {
+    int time;
+    int code;
+    int n;
+  };
+
+  // typed events of the current time step, flushed at the end of each Tock
+  // and on decommissioning.
+  std::vector<BufferedEvent> event_buf_;
+
   // populated lazily and no need to persist.
   std::set<std::string> uniq_outcommods_;
 
@@ -415,10 +598,55 @@ class Reactor : public cyclus::Facility,
   }
   double longitude;
 
+  #pragma cyclus var { \
+    "default": "", \
+    "uilabel": "Compact Output Mode", \
+    "userlevel": 10, \
+    "doc": "Output mode for this agent's position and power time series. " \
+           "Empty or 'off' writes the regular tables. 'batches' writes the " \
+           "position to AgentPositionCompact and the time series to " \
+           "TimeSeriesBatches, one row per batch of steps. 'runs' writes " \
+           "the position the same way and the time series to " \
+           "TimeSeriesRuns, one row per run of steps with the same value.", \
+  }
+  std::string compact_output;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Profile Phases", \
+    "userlevel": 10, \
+    "doc": "If true, this facility records its call counts, wall time " \
+           "and bids or requests emitted for each phase of the time step. " \
+           "The whole-simulation totals are written to the AgentPhaseTimes " \
+           "table at the end of the simulation or when the facility is " \
+           "decommissioned.", \
+  }
+  bool profile_phases;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Memory Report Period", \
+    "userlevel": 10, \
+    "units": "time steps", \
+    "doc": "If positive, this facility writes one AgentMemory row per " \
+           "inventory buffer, with its resource and composition counts, " \
+           "quantity and estimated bytes, every memory_report_period time " \
+           "steps and on the last time step. 0 turns the report off.", \
+  }
+  int memory_report_period;
+
   cyclus::toolkit::Position coordinates;
 
   /// Records an agent's latitude and longitude to the output db
   void RecordPosition();
+
+  /// fuel request targets of the current time step
+  MaterialPool target_pool_;
+
+  PhaseProfile profile_;
+
+  /// POWER time series values when compact output is on
+  SeriesBuffer power_series_;
 };
 
 } // namespace cycamore
@@ -428,6 +428,215 @@ TEST(ReactorTests, SpentFuelProperCommodTracking) {
   EXPECT_EQ(2*(simdur-1), qr.rows.size());
 }
 
+// Check that the bounded spent fuel bid strategies still trade away the
+// right commodities while cutting the number of offers.
+TEST(ReactorTests, SpentFuelBidStrategies) {
+  std::string base =
+     "  <fuel_inrecipes>  <val>uox</val>      <val>mox</val>      </fuel_inrecipes>  "
+     "  <fuel_outrecipes> <val>spentuox</val> <val>spentmox</val> </fuel_outrecipes>  "
+     "  <fuel_incommods>  <val>uox</val>      <val>mox</val>      </fuel_incommods>  "
+     "  <fuel_outcommods> <val>waste1</val>   <val>waste2</val>   </fuel_outcommods>  "
+     ""
+     "  <cycle_time>1</cycle_time>  "
+     "  <refuel_time>0</refuel_time>  "
+     "  <assem_size>1</assem_size>  "
+     "  <n_assem_core>3</n_assem_core>  "
+     "  <n_assem_batch>3</n_assem_batch>  ";
+
+  std::string strategies[] = {"oldest_n", "lot"};
+  for (int i = 0; i < 2; i++) {
+    std::string config = base + "<spent_bid_strategy>" + strategies[i] +
+                         "</spent_bid_strategy>";
+    int simdur = 7;
+    cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Reactor"), config, simdur);
+    sim.AddSource("uox").capacity(1).Finalize();
+    sim.AddSource("mox").capacity(2).Finalize();
+    sim.AddSink("waste1").Finalize();
+    sim.AddSink("waste2").Finalize();
+    sim.AddRecipe("uox", c_uox());
+    sim.AddRecipe("spentuox", c_spentuox());
+    sim.AddRecipe("mox", c_mox());
+    sim.AddRecipe("spentmox", c_spentmox());
+    int id = sim.Run();
+
+    std::vector<Cond> conds;
+    conds.push_back(Cond("SenderId", "==", id));
+    conds.push_back(Cond("Commodity", "==", std::string("waste1")));
+    QueryResult qr = sim.db().Query("Transactions", &conds);
+    EXPECT_EQ(simdur-1, qr.rows.size()) << strategies[i];
+
+    // a single mox offer per step: one assembly for oldest_n, the two
+    // assemblies combined for lot
+    conds[1] = Cond("Commodity", "==", std::string("waste2"));
+    qr = sim.db().Query("Transactions", &conds);
+    EXPECT_EQ(simdur-1, qr.rows.size()) << strategies[i];
+    if (strategies[i] == "lot") {
+      for (int j = 0; j < qr.rows.size(); j++) {
+        Material::Ptr m = sim.GetMaterial(qr.GetVal<int>("ResourceId", j));
+        EXPECT_DOUBLE_EQ(2, m->quantity());
+        MatQuery mq(m);
+        MatQuery want(Material::CreateUntracked(2, c_spentmox()));
+        EXPECT_NEAR(want.mass("Pu239"), mq.mass("Pu239"), 1e-10);
+      }
+    }
+  }
+}
+
+// Check that batched fresh fuel requests are filled with whole assemblies
+// that are then handled individually.
+TEST(ReactorTests, BatchRequests) {
+  std::string config =
+     "  <fuel_inrecipes>  <val>uox</val>      </fuel_inrecipes>  "
+     "  <fuel_outrecipes> <val>spentuox</val> </fuel_outrecipes>  "
+     "  <fuel_incommods>  <val>uox</val>      </fuel_incommods>  "
+     "  <fuel_outcommods> <val>waste</val>    </fuel_outcommods>  "
+     ""
+     "  <cycle_time>1</cycle_time>  "
+     "  <refuel_time>0</refuel_time>  "
+     "  <assem_size>1</assem_size>  "
+     "  <n_assem_core>3</n_assem_core>  "
+     "  <n_assem_batch>3</n_assem_batch>  "
+     "  <batch_requests>1</batch_requests>  ";
+
+  int simdur = 3;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Reactor"), config, simdur);
+  sim.AddSource("uox").Finalize();
+  sim.AddSink("waste").Finalize();
+  sim.AddRecipe("uox", c_uox());
+  sim.AddRecipe("spentuox", c_spentuox());
+  int id = sim.Run();
+
+  // a single fresh fuel transaction fills the whole core
+  std::vector<Cond> conds;
+  conds.push_back(Cond("ReceiverId", "==", id));
+  conds.push_back(Cond("Time", "==", 0));
+  QueryResult qr = sim.db().Query("Transactions", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_DOUBLE_EQ(3, sim.GetMaterial(qr.GetVal<int>("ResourceId"))->quantity());
+
+  // ... but the assemblies are discharged and traded individually
+  conds.clear();
+  conds.push_back(Cond("SenderId", "==", id));
+  conds.push_back(Cond("Time", "==", 1));
+  qr = sim.db().Query("Transactions", &conds);
+  ASSERT_EQ(3, qr.rows.size());
+  for (int i = 0; i < qr.rows.size(); i++) {
+    Material::Ptr m = sim.GetMaterial(qr.GetVal<int>("ResourceId", i));
+    EXPECT_DOUBLE_EQ(1, m->quantity());
+  }
+}
+
+// Check that a batched fill short of a whole assembly is held back and topped
+// up by the next request instead of being loaded as a short assembly.
+TEST(ReactorTests, BatchRequestsFractional) {
+  std::string config =
+     "  <fuel_inrecipes>  <val>uox</val>      </fuel_inrecipes>  "
+     "  <fuel_outrecipes> <val>spentuox</val> </fuel_outrecipes>  "
+     "  <fuel_incommods>  <val>uox</val>      </fuel_incommods>  "
+     "  <fuel_outcommods> <val>waste</val>    </fuel_outcommods>  "
+     ""
+     "  <cycle_time>10</cycle_time>  "
+     "  <refuel_time>0</refuel_time>  "
+     "  <assem_size>300</assem_size>  "
+     "  <n_assem_core>2</n_assem_core>  "
+     "  <n_assem_batch>1</n_assem_batch>  "
+     "  <batch_requests>1</batch_requests>  "
+     "  <reactor_events>typed</reactor_events>  ";
+
+  int simdur = 3;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Reactor"), config, simdur);
+  sim.AddSource("uox").capacity(450).Finalize();
+  sim.AddRecipe("uox", c_uox());
+  sim.AddRecipe("spentuox", c_spentuox());
+  int id = sim.Run();
+
+  // 450 kg make one assembly at t = 0 and the other 150 kg wait for the
+  // 150 kg requested at t = 1
+  std::vector<Cond> conds;
+  conds.push_back(Cond("ReceiverId", "==", id));
+  conds.push_back(Cond("Time", "==", 1));
+  QueryResult qr = sim.db().Query("Transactions", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_NEAR(150,
+              sim.GetMaterial(qr.GetVal<int>("ResourceId"))->quantity(),
+              1e-8);
+
+  conds.clear();
+  conds.push_back(Cond("Event", "==", 6));  // LOAD
+  qr = sim.db().Query("ReactorEventCodes", &conds);
+  ASSERT_EQ(2, qr.rows.size());
+  for (int i = 0; i < qr.rows.size(); i++) {
+    EXPECT_EQ(i, qr.GetVal<int>("Time", i));
+    EXPECT_EQ(1, qr.GetVal<int>("NAssemblies", i));
+  }
+
+  // the core is only full, and the cycle only starts, once both assemblies
+  // are whole
+  conds[0] = Cond("Event", "==", 1);  // CYCLE_START
+  qr = sim.db().Query("ReactorEventCodes", &conds);
+  ASSERT_EQ(1, qr.rows.size());
+  EXPECT_EQ(1, qr.GetVal<int>("Time"));
+}
+
+// Check that the typed event table carries the same events as the string
+// table, with numeric assembly counts.
+TEST(ReactorTests, TypedEvents) {
+  std::string config =
+     "  <fuel_inrecipes>  <val>lwr_fresh</val>  </fuel_inrecipes>  "
+     "  <fuel_outrecipes> <val>lwr_spent</val>  </fuel_outrecipes>  "
+     "  <fuel_incommods>  <val>enriched_u</val> </fuel_incommods>  "
+     "  <fuel_outcommods> <val>waste</val>      </fuel_outcommods>  "
+     ""
+     "  <cycle_time>2</cycle_time>  "
+     "  <refuel_time>0</refuel_time>  "
+     "  <assem_size>300</assem_size>  "
+     "  <n_assem_core>2</n_assem_core>  "
+     "  <n_assem_batch>1</n_assem_batch>  "
+     "  <reactor_events>both</reactor_events>  ";
+
+  int simdur = 9;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Reactor"), config, simdur);
+  sim.AddSource("enriched_u").Finalize();
+  sim.AddRecipe("lwr_fresh", c_uox());
+  sim.AddRecipe("lwr_spent", c_spentuox());
+  int id = sim.Run();
+
+  QueryResult strs = sim.db().Query("ReactorEvents", NULL);
+  QueryResult codes = sim.db().Query("ReactorEventCodes", NULL);
+  ASSERT_EQ(strs.rows.size(), codes.rows.size());
+
+  std::vector<Cond> conds;
+  conds.push_back(Cond("Event", "==", 6));  // LOAD
+  conds.push_back(Cond("Time", "==", 0));
+  codes = sim.db().Query("ReactorEventCodes", &conds);
+  ASSERT_EQ(1, codes.rows.size());
+  EXPECT_EQ(2, codes.GetVal<int>("NAssemblies"));
+
+  conds[0] = Cond("Event", "==", 4);  // DISCHARGE
+  conds[1] = Cond("Time", "==", 2);
+  codes = sim.db().Query("ReactorEventCodes", &conds);
+  ASSERT_EQ(1, codes.rows.size());
+  EXPECT_EQ(1, codes.GetVal<int>("NAssemblies"));
+
+  // cycle starts are recorded in the Tock and keep their own time step,
+  // including one on the last step of the simulation
+  std::vector<Cond> str_conds;
+  str_conds.push_back(Cond("Event", "==", std::string("CYCLE_START")));
+  strs = sim.db().Query("ReactorEvents", &str_conds);
+  std::vector<Cond> code_conds;
+  code_conds.push_back(Cond("Event", "==", 1));  // CYCLE_START
+  codes = sim.db().Query("ReactorEventCodes", &code_conds);
+  ASSERT_EQ(strs.rows.size(), codes.rows.size());
+  std::multiset<int> str_times;
+  std::multiset<int> code_times;
+  for (int i = 0; i < strs.rows.size(); ++i) {
+    str_times.insert(strs.GetVal<int>("Time", i));
+    code_times.insert(codes.GetVal<int>("Time", i));
+  }
+  EXPECT_EQ(str_times, code_times);
+  EXPECT_EQ(1, code_times.count(simdur - 1));
+}
+
 // The user can optionally omit fuel preferences.  In the case where
 // preferences are adjusted, the ommitted preference vector must be populated
 // with default values - if it wasn't then preferences won't be adjusted
@@ -533,6 +742,48 @@ TEST(ReactorTests, RecipeChange) {
   EXPECT_TRUE(0 < mq.mass(id("H1")));
 }
 
+// Recipe changes given out of time order must still apply on their own time
+// steps.
+TEST(ReactorTests, RecipeChangeUnsorted) {
+  std::string config =
+     "  <fuel_inrecipes>  <val>lwr_fresh</val>  </fuel_inrecipes>  "
+     "  <fuel_outrecipes> <val>lwr_spent</val>  </fuel_outrecipes>  "
+     "  <fuel_incommods>  <val>enriched_u</val> </fuel_incommods>  "
+     "  <fuel_outcommods> <val>waste</val>      </fuel_outcommods>  "
+     ""
+     "  <cycle_time>1</cycle_time>  "
+     "  <refuel_time>0</refuel_time>  "
+     "  <assem_size>300</assem_size>  "
+     "  <n_assem_core>1</n_assem_core>  "
+     "  <n_assem_batch>1</n_assem_batch>  "
+     ""
+     "  <recipe_change_times>   <val>35</val>         <val>25</val>         </recipe_change_times>"
+     "  <recipe_change_commods> <val>enriched_u</val> <val>enriched_u</val> </recipe_change_commods>"
+     "  <recipe_change_in>      <val>lwr_fresh</val>  <val>water</val>      </recipe_change_in>"
+     "  <recipe_change_out>     <val>lwr_spent</val>  <val>lwr_spent</val>  </recipe_change_out>";
+
+  int simdur = 50;
+  cyclus::MockSim sim(cyclus::AgentSpec(":cycamore:Reactor"), config, simdur);
+  sim.AddSource("enriched_u").Finalize();
+  sim.AddSink("waste").Finalize();
+  sim.AddRecipe("lwr_fresh", c_uox());
+  sim.AddRecipe("lwr_spent", c_spentuox());
+  sim.AddRecipe("water", c_water());
+  int aid = sim.Run();
+
+  int times[] = {24, 26, 36};
+  bool water[] = {false, true, false};
+  for (int i = 0; i < 3; i++) {
+    std::vector<Cond> conds;
+    conds.push_back(Cond("Time", "==", times[i]));
+    conds.push_back(Cond("ReceiverId", "==", aid));
+    QueryResult qr = sim.db().Query("Transactions", &conds);
+    MatQuery mq(sim.GetMaterial(qr.GetVal<int>("ResourceId")));
+    EXPECT_TRUE(0 < mq.qty());
+    EXPECT_EQ(water[i], 0 < mq.mass(id("H1"))) << "time " << times[i];
+  }
+}
+
 TEST(ReactorTests, Retire) {
   std::string config = 
      "  <fuel_inrecipes>  <val>lwr_fresh</val>  </fuel_inrecipes>  "
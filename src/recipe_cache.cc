@@ -0,0 +1,25 @@
+#include "recipe_cache.h"
+
+namespace cycamore {
+
+int RecipeCache::Intern(cyclus::Context* ctx, const std::string& name) {
+  std::map<std::string, int>::iterator it = handles_.find(name);
+  if (it != handles_.end()) {
+    return it->second;
+  }
+
+  cyclus::Composition::Ptr c = ctx->GetRecipe(name);
+  int h = names_.size();
+  handles_[name] = h;
+  names_.push_back(name);
+  comps_.push_back(c);
+  return h;
+}
+
+void RecipeCache::Refresh(cyclus::Context* ctx) {
+  for (int i = 0; i < names_.size(); ++i) {
+    comps_[i] = ctx->GetRecipe(names_[i]);
+  }
+}
+
+}  // namespace cycamore
@@ -0,0 +1,46 @@
+#ifndef CYCAMORE_SRC_RECIPE_CACHE_H_
+#define CYCAMORE_SRC_RECIPE_CACHE_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "cyclus.h"
+
+namespace cycamore {
+
+/// RecipeCache interns the recipe names an agent uses and resolves each one
+/// to its composition once.  Agents intern their recipes when they enter the
+/// simulation or when a scheduled recipe change fires, keep the returned
+/// integer handles, and look compositions up by handle in their hot loops.
+/// This turns a string-keyed context lookup per request or assembly into a
+/// vector index.  Refresh re-resolves every interned name for agents whose
+/// recipes may be redefined under the same name.
+class RecipeCache {
+ public:
+  /// Returns the handle for the recipe name, resolving it with ctx the
+  /// first time the name is seen.  Throws like Context::GetRecipe if the
+  /// recipe does not exist.
+  int Intern(cyclus::Context* ctx, const std::string& name);
+
+  /// Returns the composition of the recipe with handle h.
+  cyclus::Composition::Ptr Get(int h) const { return comps_[h]; }
+
+  /// Returns the name of the recipe with handle h.
+  const std::string& name(int h) const { return names_[h]; }
+
+  /// Resolves every interned name again with ctx.  Handles stay valid.
+  void Refresh(cyclus::Context* ctx);
+
+  /// Returns the number of interned recipes.
+  int size() const { return names_.size(); }
+
+ private:
+  std::map<std::string, int> handles_;
+  std::vector<std::string> names_;
+  std::vector<cyclus::Composition::Ptr> comps_;
+};
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_RECIPE_CACHE_H_
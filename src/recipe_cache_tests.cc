@@ -0,0 +1,58 @@
+#include "recipe_cache.h"
+
+#include <gtest/gtest.h>
+
+#include "test_context.h"
+
+using cyclus::CompMap;
+using cyclus::Composition;
+
+namespace cycamore {
+
+namespace {
+
+Composition::Ptr Uranium(double assay) {
+  CompMap m;
+  m[922350000] = assay;
+  m[922380000] = 1 - assay;
+  return Composition::CreateFromMass(m);
+}
+
+}  // namespace
+
+TEST(RecipeCacheTests, Intern) {
+  cyclus::TestContext tc;
+  Composition::Ptr leu = Uranium(0.04);
+  Composition::Ptr natu = Uranium(0.0071);
+  tc.get()->AddRecipe("leu", leu);
+  tc.get()->AddRecipe("natu", natu);
+
+  RecipeCache cache;
+  int h_leu = cache.Intern(tc.get(), "leu");
+  int h_natu = cache.Intern(tc.get(), "natu");
+  EXPECT_NE(h_leu, h_natu);
+  EXPECT_EQ(h_leu, cache.Intern(tc.get(), "leu"));
+  EXPECT_EQ(2, cache.size());
+  EXPECT_EQ(leu, cache.Get(h_leu));
+  EXPECT_EQ(natu, cache.Get(h_natu));
+  EXPECT_EQ("natu", cache.name(h_natu));
+
+  EXPECT_THROW(cache.Intern(tc.get(), "nope"), cyclus::KeyError);
+}
+
+TEST(RecipeCacheTests, Refresh) {
+  cyclus::TestContext tc;
+  tc.get()->AddRecipe("fuel", Uranium(0.04));
+
+  RecipeCache cache;
+  int h = cache.Intern(tc.get(), "fuel");
+
+  // a redefined recipe is only picked up on refresh
+  Composition::Ptr heu = Uranium(0.9);
+  tc.get()->AddRecipe("fuel", heu);
+  EXPECT_NE(heu, cache.Get(h));
+  cache.Refresh(tc.get());
+  EXPECT_EQ(heu, cache.Get(h));
+}
+
+}  // namespace cycamore
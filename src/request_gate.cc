@@ -0,0 +1,16 @@
+#include "request_gate.h"
+
+#include <algorithm>
+
+namespace cycamore {
+
+bool RequestGate::Open(double avail, double min_qty, double resume_qty) {
+  if (open_ && avail < min_qty) {
+    open_ = false;
+  } else if (!open_ && avail >= std::max(min_qty, resume_qty)) {
+    open_ = true;
+  }
+  return open_;
+}
+
+}  // namespace cycamore
@@ -0,0 +1,34 @@
+#ifndef CYCAMORE_SRC_REQUEST_GATE_H_
+#define CYCAMORE_SRC_REQUEST_GATE_H_
+
+namespace cycamore {
+
+/// RequestGate keeps a nearly full facility from putting negligible requests
+/// on the exchange.  Every request fans out into an arc per matching
+/// supplier, so a sliver of free space costs the solver as much as a real
+/// need.  The gate closes once the available space drops below a minimum
+/// request quantity and only opens again once the space has grown back to a
+/// resume quantity, so that a facility hovering around the minimum does not
+/// flip between requesting and not requesting every time step.
+///
+/// The thresholds are passed on each call so that archetypes can keep them
+/// as ordinary state variables; with a zero minimum the gate is always open.
+class RequestGate {
+ public:
+  RequestGate() : open_(true) {}
+
+  /// Returns true if a request for avail kg should be made this time step.
+  /// The gate closes when avail is below min_qty and reopens when avail
+  /// reaches resume_qty (or min_qty, whichever is larger).
+  bool Open(double avail, double min_qty, double resume_qty);
+
+  /// Returns true if the gate let the last request through.
+  bool is_open() const { return open_; }
+
+ private:
+  bool open_;
+};
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_REQUEST_GATE_H_
@@ -0,0 +1,35 @@
+#include "request_gate.h"
+
+#include <gtest/gtest.h>
+
+namespace cycamore {
+
+TEST(RequestGateTests, NoMinimum) {
+  RequestGate g;
+  EXPECT_TRUE(g.Open(0, 0, 0));
+  EXPECT_TRUE(g.Open(1e-12, 0, 0));
+  EXPECT_TRUE(g.Open(100, 0, 0));
+}
+
+TEST(RequestGateTests, Minimum) {
+  RequestGate g;
+  EXPECT_TRUE(g.Open(10, 5, 0));
+  EXPECT_FALSE(g.Open(4, 5, 0));
+  EXPECT_FALSE(g.is_open());
+  // without a larger resume quantity the minimum reopens the gate
+  EXPECT_TRUE(g.Open(5, 5, 0));
+}
+
+TEST(RequestGateTests, Hysteresis) {
+  RequestGate g;
+  EXPECT_TRUE(g.Open(6, 5, 20));
+  EXPECT_FALSE(g.Open(4, 5, 20));
+  // above the minimum but below the resume quantity stays closed
+  EXPECT_FALSE(g.Open(10, 5, 20));
+  EXPECT_TRUE(g.Open(20, 5, 20));
+  // and stays open down to the minimum again
+  EXPECT_TRUE(g.Open(10, 5, 20));
+  EXPECT_FALSE(g.Open(1, 5, 20));
+}
+
+}  // namespace cycamore
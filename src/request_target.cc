@@ -0,0 +1,15 @@
+#include "request_target.h"
+
+namespace cycamore {
+
+cyclus::Material::Ptr RequestTarget::Get(double qty,
+                                         cyclus::Composition::Ptr c) {
+  if (!mat_ || mat_->quantity() != qty || comp_ != c) {
+    mat_ = c ? cyclus::Material::CreateUntracked(qty, c)
+             : cyclus::NewBlankMaterial(qty);
+    comp_ = c;
+  }
+  return mat_;
+}
+
+}  // namespace cycamore
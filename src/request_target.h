@@ -0,0 +1,29 @@
+#ifndef CYCAMORE_SRC_REQUEST_TARGET_H_
+#define CYCAMORE_SRC_REQUEST_TARGET_H_
+
+#include "cyclus.h"
+
+namespace cycamore {
+
+/// RequestTarget keeps the untracked target material an agent puts its
+/// requests on, so that a facility asking for the same amount of the same
+/// recipe every time step reuses one target instead of allocating a new one
+/// each time.  The target is rebuilt whenever the quantity or the
+/// composition changes.  Targets are shared with the exchange and must
+/// never be modified.
+class RequestTarget {
+ public:
+  /// Returns the request target for qty kg of composition c, or a blank
+  /// target of qty kg if c is null.
+  cyclus::Material::Ptr Get(double qty, cyclus::Composition::Ptr c);
+
+ private:
+  /// the current target and the composition it was built with (null for a
+  /// blank target)
+  cyclus::Material::Ptr mat_;
+  cyclus::Composition::Ptr comp_;
+};
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_REQUEST_TARGET_H_
@@ -0,0 +1,36 @@
+#include "request_target.h"
+
+#include <gtest/gtest.h>
+
+using cyclus::Composition;
+using cyclus::Material;
+
+namespace cycamore {
+
+TEST(RequestTargetTests, Reuse) {
+  cyclus::CompMap m;
+  m[922350000] = 1;
+  Composition::Ptr c = Composition::CreateFromMass(m);
+
+  RequestTarget t;
+  Material::Ptr tgt = t.Get(10, c);
+  EXPECT_DOUBLE_EQ(10, tgt->quantity());
+  EXPECT_EQ(c, tgt->comp());
+  EXPECT_EQ(tgt, t.Get(10, c));
+
+  // a new quantity or composition gets a new target
+  Material::Ptr other = t.Get(5, c);
+  EXPECT_NE(tgt, other);
+  EXPECT_DOUBLE_EQ(5, other->quantity());
+  Composition::Ptr c2 = Composition::CreateFromMass(m);
+  EXPECT_NE(other, t.Get(5, c2));
+}
+
+TEST(RequestTargetTests, Blank) {
+  RequestTarget t;
+  Material::Ptr tgt = t.Get(3, Composition::Ptr());
+  EXPECT_DOUBLE_EQ(3, tgt->quantity());
+  EXPECT_EQ(tgt, t.Get(3, Composition::Ptr()));
+}
+
+}  // namespace cycamore
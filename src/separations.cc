@@ -1,5 +1,13 @@
 #include "separations.h"
 
+#include <algorithm>
+
+#include "comp_vec.h"
+#include "buffer_squash.h"
+#include "compact_output.h"
+#include "memory_report.h"
+#include "trade_withdrawal.h"
+
 using cyclus::Material;
 using cyclus::Composition;
 using cyclus::toolkit::ResBuf;
@@ -13,9 +21,14 @@ namespace cycamore {
 
 Separations::Separations(cyclus::Context* ctx) 
     : cyclus::Facility(ctx),
+      squash_buffers(false),
       latitude(0.0),
       longitude(0.0),
-      coordinates(latitude, longitude) {}
+      compact_output(""),
+      profile_phases(false),
+      memory_report_period(0),
+      coordinates(latitude, longitude),
+      profile_(this, profile_phases) {}
 
 cyclus::Inventories Separations::SnapshotInv() {
   cyclus::Inventories invs;
@@ -33,7 +46,6 @@ cyclus::Inventories Separations::SnapshotInv() {
     invs[it->first] = it->second.PopNRes(it->second.count());
     it->second.Push(invs[it->first]);
   }
-
   return invs;
 }
 
@@ -53,6 +65,7 @@ typedef std::map<std::string, Stream> StreamSet;
 void Separations::EnterNotify() {
   cyclus::Facility::EnterNotify();
   std::map<int, double> efficiency_;
+  std::vector<std::map<int, double> > effs;
 
   StreamSet::iterator it;
   std::map<int, double>::iterator it2;
@@ -68,8 +81,10 @@ void Separations::EnterNotify() {
     for (it2 = stream.second.begin(); it2 != stream.second.end(); it2++) {
       efficiency_[it2->first] += it2->second;
     }
+    effs.push_back(stream.second);
     RecordPosition();
   }
+  sepmat_ = SepMatrix(effs);
 
   std::vector<int> eff_pb_;
   for (it2 = efficiency_.begin(); it2 != efficiency_.end(); it2++) {
@@ -103,6 +118,7 @@ void Separations::EnterNotify() {
 }
 
 void Separations::Tick() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::TICK);
   if (feed.count() == 0) {
     return;
   }
@@ -110,26 +126,26 @@ void Separations::Tick() {
   Material::Ptr mat = feed.Pop(pop_qty, cyclus::eps_rsrc());
   double orig_qty = mat->quantity();
 
+  // one pass over the feed composition separates it into all streams
+  std::vector<Material::Ptr> stagedsep = sepmat_.Split(mat);
+  std::vector<ResBuf<Material>*> bufs;
+  bufs.reserve(stagedsep.size());
+
   StreamSet::iterator it;
   double maxfrac = 1;
-  std::map<std::string, Material::Ptr> stagedsep;
-  for (it = streams_.begin(); it != streams_.end(); ++it) {
-    Stream info = it->second;
-    std::string name = it->first;
-    stagedsep[name] = SepMaterial(info.second, mat);
-    double frac = streambufs[name].space() / stagedsep[name]->quantity();
+  int i = 0;
+  for (it = streams_.begin(); it != streams_.end(); ++it, ++i) {
+    bufs.push_back(&streambufs[it->first]);
+    double frac = bufs[i]->space() / stagedsep[i]->quantity();
     if (frac < maxfrac) {
       maxfrac = frac;
     }
   }
 
-  std::map<std::string, Material::Ptr>::iterator itf;
-  for (itf = stagedsep.begin(); itf != stagedsep.end(); ++itf) {
-    std::string name = itf->first;
-    Material::Ptr m = itf->second;
+  for (i = 0; i < stagedsep.size(); ++i) {
+    Material::Ptr m = stagedsep[i];
     if (m->quantity() > 0) {
-      streambufs[name].Push(
-          mat->ExtractComp(m->quantity() * maxfrac, m->comp()));
+      bufs[i]->Push(mat->ExtractComp(m->quantity() * maxfrac, m->comp()));
     }
   }
 
@@ -148,30 +164,130 @@ void Separations::Tick() {
   }
 }
 
+// Upper bound on the number of distinct feed compositions whose splits are
+// remembered; the cache is simply reset when it fills up.
+static const int kMaxCachedSplits = 1000;
+
+SepMatrix::SepMatrix(const std::vector<std::map<int, double> >& effs)
+    : nstreams_(effs.size()) {
+  for (int s = 0; s < nstreams_; ++s) {
+    std::map<int, double>::const_iterator it;
+    for (it = effs[s].begin(); it != effs[s].end(); ++it) {
+      std::vector<double>& key = keys_[it->first];
+      if (key.empty()) {
+        key.resize(nstreams_, -1);
+      }
+      key[s] = it->second;
+    }
+  }
+}
+
+int SepMatrix::Row(int nuc) {
+  std::map<int, int>::iterator found = rows_.find(nuc);
+  if (found != rows_.end()) {
+    return found->second;
+  }
+
+  int elem = (nuc / 10000000) * 10000000;
+  std::map<int, std::vector<double> >::const_iterator nuc_key =
+      keys_.find(nuc);
+  std::map<int, std::vector<double> >::const_iterator elem_key =
+      keys_.find(elem);
+
+  std::vector<double> row(nstreams_, 0);
+  bool any = false;
+  for (int s = 0; s < nstreams_; ++s) {
+    if (nuc_key != keys_.end() && nuc_key->second[s] >= 0) {
+      row[s] = nuc_key->second[s];
+    } else if (elem_key != keys_.end() && elem_key->second[s] >= 0) {
+      row[s] = elem_key->second[s];
+    }
+    any = any || row[s] > 0;
+  }
+
+  int offset = -1;
+  if (any) {
+    offset = effs_.size();
+    effs_.insert(effs_.end(), row.begin(), row.end());
+  }
+  rows_[nuc] = offset;
+  return offset;
+}
+
+std::vector<Material::Ptr> SepMatrix::Split(Material::Ptr mat) {
+  int id = mat->comp()->id();
+  std::map<int, Splits>::iterator it = splits_.find(id);
+  if (it == splits_.end()) {
+    if (splits_.size() >= kMaxCachedSplits) {
+      splits_.clear();
+    }
+    it = splits_.insert(std::make_pair(id, Compute(mat->comp()))).first;
+  }
+
+  const Splits& splits = it->second;
+  double qty = mat->quantity();
+  std::vector<Material::Ptr> sep;
+  sep.reserve(nstreams_);
+  for (int s = 0; s < nstreams_; ++s) {
+    sep.push_back(
+        Material::CreateUntracked(splits[s].first * qty, splits[s].second));
+  }
+  return sep;
+}
+
+SepMatrix::Splits SepMatrix::Compute(Composition::Ptr c) {
+  CompVec v(c);
+  const std::vector<int>& nucs = v.nucs();
+  const std::vector<double>& mass = v.mass();
+
+  std::vector<CompMap> sepcomps(nstreams_);
+  std::vector<double> tot_frac(nstreams_, 0);
+  for (int i = 0; i < v.size(); ++i) {
+    int r = Row(nucs[i]);
+    if (r < 0) {
+      continue;
+    }
+    const double* row = &effs_[r];
+    for (int s = 0; s < nstreams_; ++s) {
+      if (row[s] > 0) {
+        double sepfrac = mass[i] * row[s];
+        sepcomps[s].insert(sepcomps[s].end(), std::make_pair(nucs[i], sepfrac));
+        tot_frac[s] += sepfrac;
+      }
+    }
+  }
+
+  Splits splits;
+  splits.reserve(nstreams_);
+  for (int s = 0; s < nstreams_; ++s) {
+    splits.push_back(std::make_pair(
+        tot_frac[s], Composition::CreateFromMass(sepcomps[s])));
+  }
+  return splits;
+}
+
 // Note that this returns an untracked material that should just be used for
 // its composition and qty - not in any real inventories, etc.
 Material::Ptr SepMaterial(std::map<int, double> effs, Material::Ptr mat) {
-  CompMap cm = mat->comp()->mass();
-  cyclus::compmath::Normalize(&cm, mat->quantity());
+  CompVec v(mat->comp());
+  const std::vector<int>& nucs = v.nucs();
+  const std::vector<double>& mass = v.mass();
+  double qty = mat->quantity();
   double tot_qty = 0;
   CompMap sepcomp;
 
-  CompMap::iterator it;
-  for (it = cm.begin(); it != cm.end(); ++it) {
-    int nuc = it->first;
+  for (int i = 0; i < v.size(); ++i) {
+    int nuc = nucs[i];
     int elem = (nuc / 10000000) * 10000000;
-    double eff = 0;
-    if (effs.count(nuc) > 0) {
-      eff = effs[nuc];
-    } else if (effs.count(elem) > 0) {
-      eff = effs[elem];
-    } else {
-      continue;
+    std::map<int, double>::const_iterator it = effs.find(nuc);
+    if (it == effs.end()) {
+      it = effs.find(elem);
+      if (it == effs.end()) {
+        continue;
+      }
     }
-
-    double qty = it->second;
-    double sepqty = qty * eff;
-    sepcomp[nuc] = sepqty;
+    double sepqty = mass[i] * qty * it->second;
+    sepcomp.insert(sepcomp.end(), std::make_pair(nuc, sepqty));
     tot_qty += sepqty;
   }
 
@@ -181,6 +297,7 @@ Material::Ptr SepMaterial(std::map<int, double> effs, Material::Ptr mat) {
 
 std::set<cyclus::RequestPortfolio<Material>::Ptr>
 Separations::GetMatlRequests() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_REQUESTS);
   using cyclus::RequestPortfolio;
   std::set<RequestPortfolio<Material>::Ptr> ports;
 
@@ -195,11 +312,11 @@ Separations::GetMatlRequests() {
   bool exclusive = false;
   RequestPortfolio<Material>::Ptr port(new RequestPortfolio<Material>());
 
-  Material::Ptr m = cyclus::NewBlankMaterial(feed.space());
+  cyclus::Composition::Ptr c;
   if (!feed_recipe.empty()) {
-    Composition::Ptr c = context()->GetRecipe(feed_recipe);
-    m = Material::CreateUntracked(feed.space(), c);
+    c = context()->GetRecipe(feed_recipe);
   }
+  Material::Ptr m = req_target_.Get(feed.space(), c);
 
   std::vector<cyclus::Request<Material>*> reqs;
   for (int i = 0; i < feed_commods.size(); i++) {
@@ -210,6 +327,7 @@ Separations::GetMatlRequests() {
   port->AddMutualReqs(reqs);
   ports.insert(port);
 
+  profile_.Count(ports);
   return ports;
 }
 
@@ -217,29 +335,52 @@ void Separations::GetMatlTrades(
     const std::vector<cyclus::Trade<Material> >& trades,
     std::vector<std::pair<cyclus::Trade<Material>, Material::Ptr> >&
         responses) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_TRADES);
   using cyclus::Trade;
 
-  std::vector<cyclus::Trade<cyclus::Material> >::const_iterator it;
+  // group the trades by commodity so that each buffer is looked up and drawn
+  // from once, however many trades it fills
+  std::map<std::string, std::vector<int> > by_commod;
   for (int i = 0; i < trades.size(); i++) {
-    std::string commod = trades[i].request->commodity();
+    by_commod[trades[i].request->commodity()].push_back(i);
+  }
+
+  std::vector<Material::Ptr> mats(trades.size());
+  std::map<std::string, std::vector<int> >::iterator it;
+  for (it = by_commod.begin(); it != by_commod.end(); ++it) {
+    const std::string& commod = it->first;
+    std::map<std::string, ResBuf<Material> >::iterator found =
+        streambufs.find(commod);
+    ResBuf<Material>* buf;
     if (commod == leftover_commod) {
-      double amt = std::min(leftover.quantity(), trades[i].amt);
-      Material::Ptr m = leftover.Pop(amt, cyclus::eps_rsrc());
-      responses.push_back(std::make_pair(trades[i], m));
-    } else if (streambufs.count(commod) > 0) {
-      double amt = std::min(streambufs[commod].quantity(), trades[i].amt);
-      Material::Ptr m = streambufs[commod].Pop(amt, cyclus::eps_rsrc());
-      responses.push_back(std::make_pair(trades[i], m));
+      buf = &leftover;
+    } else if (found != streambufs.end()) {
+      buf = &found->second;
     } else {
       throw ValueError("invalid commodity " + commod +
                        " on trade matched to prototype " + prototype());
     }
+
+    std::vector<int>& idx = it->second;
+    std::vector<double> qtys;
+    for (int j = 0; j < idx.size(); j++) {
+      qtys.push_back(trades[idx[j]].amt);
+    }
+    MatVec out = WithdrawTrades(*buf, qtys);
+    for (int j = 0; j < idx.size(); j++) {
+      mats[idx[j]] = out[j];
+    }
+  }
+
+  for (int i = 0; i < trades.size(); i++) {
+    responses.push_back(std::make_pair(trades[i], mats[i]));
   }
 }
 
 void Separations::AcceptMatlTrades(
     const std::vector<std::pair<cyclus::Trade<Material>, Material::Ptr> >&
         responses) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::ACCEPT_MATL_TRADES);
   std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                         cyclus::Material::Ptr> >::const_iterator trade;
 
@@ -250,88 +391,98 @@ void Separations::AcceptMatlTrades(
 
 std::set<cyclus::BidPortfolio<Material>::Ptr> Separations::GetMatlBids(
     cyclus::CommodMap<Material>::type& commod_requests) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_BIDS);
   using cyclus::BidPortfolio;
 
-  bool exclusive = false;
   std::set<BidPortfolio<Material>::Ptr> ports;
 
   // bid streams
+  cyclus::CommodMap<Material>::type::iterator rit;
   std::map<std::string, ResBuf<Material> >::iterator it;
   for (it = streambufs.begin(); it != streambufs.end(); ++it) {
-    std::string commod = it->first;
-    std::vector<Request<Material>*>& reqs = commod_requests[commod];
-    if (reqs.size() == 0) {
-      continue;
-    } else if (streambufs[commod].quantity() < cyclus::eps_rsrc()) {
-      continue;
+    rit = commod_requests.find(it->first);
+    if (rit != commod_requests.end()) {
+      BidBuf_(it->second, rit->second, ports);
     }
+  }
 
-    MatVec mats = streambufs[commod].PopN(streambufs[commod].count());
-    streambufs[commod].Push(mats);
-
-    BidPortfolio<Material>::Ptr port(new BidPortfolio<Material>());
+  // bid leftovers
+  rit = commod_requests.find(leftover_commod);
+  if (rit != commod_requests.end()) {
+    BidBuf_(leftover, rit->second, ports);
+  }
 
-    for (int j = 0; j < reqs.size(); j++) {
-      Request<Material>* req = reqs[j];
-      double tot_bid = 0;
-      for (int k = 0; k < mats.size(); k++) {
-        Material::Ptr m = mats[k];
-        tot_bid += m->quantity();
+  profile_.Count(ports);
+  return ports;
+}
 
-        // this fix the problem of the cyclus exchange manager which crashes
-        // when a bid with a quantity <=0 is offered.
-        if (m->quantity() > cyclus::eps_rsrc()) {
-          port->AddBid(req, m, this, exclusive);
-        }
+void Separations::BidBuf_(
+    ResBuf<Material>& buf, std::vector<Request<Material>*>& reqs,
+    std::set<cyclus::BidPortfolio<Material>::Ptr>& ports) {
+  using cyclus::BidPortfolio;
 
-        if (tot_bid >= req->target()->quantity()) {
-          break;
-        }
-      }
-    }
+  double tot_qty = buf.quantity();
+  if (reqs.size() == 0 || tot_qty < cyclus::eps_rsrc()) {
+    return;
+  }
 
-    double tot_qty = streambufs[commod].quantity();
-    cyclus::CapacityConstraint<Material> cc(tot_qty);
-    port->AddConstraint(cc);
-    ports.insert(port);
+  // the buffer is peeked once and its running quantities are shared by all
+  // requests
+  MatVec mats = buf.PopN(buf.count());
+  buf.Push(mats);
+  std::vector<double> cum(mats.size());
+  double tot_bid = 0;
+  for (int k = 0; k < mats.size(); k++) {
+    tot_bid += mats[k]->quantity();
+    cum[k] = tot_bid;
   }
 
-  // bid leftovers
-  std::vector<Request<Material>*>& reqs = commod_requests[leftover_commod];
-  if (reqs.size() > 0 && leftover.quantity() >= cyclus::eps_rsrc()) {
-    MatVec mats = leftover.PopN(leftover.count());
-    leftover.Push(mats);
-
-    BidPortfolio<Material>::Ptr port(new BidPortfolio<Material>());
-
-    for (int j = 0; j < reqs.size(); j++) {
-      Request<Material>* req = reqs[j];
-      double tot_bid = 0;
-      for (int k = 0; k < mats.size(); k++) {
-        Material::Ptr m = mats[k];
-        tot_bid += m->quantity();
-
-        // this fix the problem of the cyclus exchange manager which crashes
-        // when a bid with a quantity <=0 is offered.
-        if (m->quantity() > cyclus::eps_rsrc()) {
-          port->AddBid(req, m, this, exclusive);
-        }
-
-        if (tot_bid >= req->target()->quantity()) {
-          break;
-        }
+  bool exclusive = false;
+  BidPortfolio<Material>::Ptr port(new BidPortfolio<Material>());
+  for (int j = 0; j < reqs.size(); j++) {
+    Request<Material>* req = reqs[j];
+    // bid materials up to and including the first that covers the request
+    int n = std::lower_bound(cum.begin(), cum.end(),
+                             req->target()->quantity()) - cum.begin();
+    n = std::min(n + 1, static_cast<int>(mats.size()));
+    for (int k = 0; k < n; k++) {
+      // this fix the problem of the cyclus exchange manager which crashes
+      // when a bid with a quantity <=0 is offered.
+      if (mats[k]->quantity() > cyclus::eps_rsrc()) {
+        port->AddBid(req, mats[k], this, exclusive);
       }
     }
-
-    cyclus::CapacityConstraint<Material> cc(leftover.quantity());
-    port->AddConstraint(cc);
-    ports.insert(port);
   }
 
-  return ports;
+  cyclus::CapacityConstraint<Material> cc(tot_qty);
+  port->AddConstraint(cc);
+  ports.insert(port);
 }
 
-void Separations::Tock() {}
+void Separations::Tock() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::TOCK);
+  if (squash_buffers) {
+    SquashRuns(feed);
+    std::map<std::string, ResBuf<Material> >::iterator it;
+    for (it = streambufs.begin(); it != streambufs.end(); ++it) {
+      SquashRuns(it->second);
+    }
+    SquashRuns(leftover);
+  }
+  if (MemoryReport::Due(context(), memory_report_period)) {
+    MemoryReport::Record(this, "feed", feed);
+    std::map<std::string, ResBuf<Material> >::iterator it;
+    for (it = streambufs.begin(); it != streambufs.end(); ++it) {
+      MemoryReport::Record(this, "streambufs[" + it->first + "]", it->second);
+    }
+    MemoryReport::Record(this, "leftover", leftover);
+  }
+}
+
+void Separations::Decommission() {
+  profile_.Flush();
+  cyclus::Facility::Decommission();
+}
 
 bool Separations::CheckDecommissionCondition() {
   if (leftover.count() > 0) {
@@ -349,15 +500,8 @@ bool Separations::CheckDecommissionCondition() {
 }
 
 void Separations::RecordPosition() {
-  std::string specification = this->spec();
-  context()
-      ->NewDatum("AgentPosition")
-      ->AddVal("Spec", specification)
-      ->AddVal("Prototype", this->prototype())
-      ->AddVal("AgentId", id())
-      ->AddVal("Latitude", latitude)
-      ->AddVal("Longitude", longitude)
-      ->Record();
+  CompactOutput::RecordPosition(this, latitude, longitude,
+                                 compact_output);
 }
 
 extern "C" cyclus::Agent* ConstructSeparations(cyclus::Context* ctx) {
@@ -3,6 +3,9 @@
 
 #include "cyclus.h"
 #include "cycamore_version.h"
+#include "material_pool.h"
+#include "phase_profile.h"
+#include "request_target.h"
 
 namespace cycamore {
 
@@ -16,6 +19,57 @@ namespace cycamore {
 cyclus::Material::Ptr SepMaterial(std::map<int, double> effs,
                                   cyclus::Material::Ptr mat);
 
+/// SepMatrix is the compiled form of a set of separations streams.  Each
+/// stream's efficiencies (keyed by nuclide or element) are flattened into a
+/// dense per-nuclide row holding the efficiency for every stream, with a
+/// stream's nuclide-specific efficiency taking precedence over its element
+/// efficiency.  Rows for feed nuclides are resolved once, on first use, so
+/// separating a material into all streams is a single pass over its
+/// composition instead of two map lookups per nuclide per stream.  The
+/// separated stream compositions are also remembered per feed composition so
+/// that repeated feed (e.g. spent fuel from identical reactor recipes) reuses
+/// the same Composition objects instead of creating and recording new ones
+/// every time step.
+class SepMatrix {
+ public:
+  SepMatrix() : nstreams_(0) {}
+
+  /// Compiles the given per-stream efficiency maps.  Streams keep the order
+  /// in which they are given here.
+  explicit SepMatrix(const std::vector<std::map<int, double> >& effs);
+
+  /// Returns the number of compiled streams.
+  int nstreams() const { return nstreams_; }
+
+  /// Separates mat into every stream at once, returning one untracked
+  /// material per stream (in compiled order) with the same meaning as the
+  /// result of SepMaterial.
+  std::vector<cyclus::Material::Ptr> Split(cyclus::Material::Ptr mat);
+
+ private:
+  /// per-stream separated fraction of the feed quantity and the separated
+  /// composition
+  typedef std::vector<std::pair<double, cyclus::Composition::Ptr> > Splits;
+
+  /// Computes the separated splits for one unit of feed with composition c.
+  Splits Compute(cyclus::Composition::Ptr c);
+
+  /// Returns the offset of nuc's resolved row in effs_ or -1 if no stream
+  /// separates it.
+  int Row(int nuc);
+
+  int nstreams_;
+  /// user specified efficiencies (negative if unspecified) per nuclide or
+  /// element key, nstreams_ values per key
+  std::map<int, std::vector<double> > keys_;
+  /// feed nuclide to resolved row offset in effs_
+  std::map<int, int> rows_;
+  /// resolved efficiencies, row-major with nstreams_ columns
+  std::vector<double> effs_;
+  /// feed composition id to separated splits
+  std::map<int, Splits> splits_;
+};
+
 /// Separations processes feed material into one or more streams containing
 /// specific elements and/or nuclides.  It uses mass-based efficiencies.
 ///
@@ -69,6 +123,7 @@ class Separations
   virtual void Tick();
   virtual void Tock();
   virtual void EnterNotify();
+  virtual void Decommission();
 
   virtual void AcceptMatlTrades(const std::vector<std::pair<
       cyclus::Trade<cyclus::Material>, cyclus::Material::Ptr> >& responses);
@@ -182,6 +237,20 @@ class Separations
   }
   cyclus::toolkit::ResBuf<cyclus::Material> leftover;
 
+  #pragma cyclus var { \
+    "default": False, \
+    "doc": "If true, each run of adjacent materials with the same" \
+           " composition in an inventory buffer is merged into one material" \
+           " at the end of every time step, instead of keeping every received" \
+           " or separated lot.  Merged lots stay parents of the merged" \
+           " material, and the buffer order is kept, so quantities drawn" \
+           " from the buffers are unchanged.  Fewer materials make snapshots" \
+           " and restarts cheaper.", \
+    "uilabel": "Squash Inventory Buffers", \
+    "userlevel": 10, \
+  }
+  bool squash_buffers;
+
   #pragma cyclus var { \
     "alias": ["streams", "commod", ["info", "buf_size", ["efficiencies", "comp", "eff"]]], \
     "uitype": ["oneormore", "outcommodity", ["pair", "double", ["oneormore", "nuclide", "double"]]], \
@@ -222,10 +291,59 @@ class Separations
   }
   double longitude;
 
+  #pragma cyclus var { \
+    "default": "", \
+    "uilabel": "Compact Output Mode", \
+    "userlevel": 10, \
+    "doc": "Output mode for this agent's position. Empty or 'off' " \
+           "writes the regular tables. 'batches' writes the position to " \
+           "AgentPositionCompact, as does 'runs'.", \
+  }
+  std::string compact_output;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Profile Phases", \
+    "userlevel": 10, \
+    "doc": "If true, this facility records its call counts, wall time " \
+           "and bids or requests emitted for each phase of the time step. " \
+           "The whole-simulation totals are written to the AgentPhaseTimes " \
+           "table at the end of the simulation or when the facility is " \
+           "decommissioned.", \
+  }
+  bool profile_phases;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Memory Report Period", \
+    "userlevel": 10, \
+    "units": "time steps", \
+    "doc": "If positive, this facility writes one AgentMemory row per " \
+           "inventory buffer, with its resource and composition counts, " \
+           "quantity and estimated bytes, every memory_report_period time " \
+           "steps and on the last time step. 0 turns the report off.", \
+  }
+  int memory_report_period;
+
   cyclus::toolkit::Position coordinates;
 
+  /// streams_ efficiencies compiled in EnterNotify
+  SepMatrix sepmat_;
+
   /// Records an agent's latitude and longitude to the output db
   void RecordPosition();
+
+  /// Adds a portfolio bidding the materials of buf on reqs to ports, with a
+  /// single capacity constraint for the buffer's quantity.  Each request is
+  /// bid the oldest materials needed to cover it.
+  void BidBuf_(cyclus::toolkit::ResBuf<cyclus::Material>& buf,
+               std::vector<cyclus::Request<cyclus::Material>*>& reqs,
+               std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr>& ports);
+
+  /// request target reused across time steps
+  RequestTarget req_target_;
+
+  PhaseProfile profile_;
 };
 
 }  // namespace cycamore
@@ -43,7 +43,53 @@ TEST(SeparationsTests, SepMaterial) {
   EXPECT_DOUBLE_EQ(0, mqsep.mass("Am242"));
 }
 
-  
+TEST(SeparationsTests, SepMatrix) {
+  CompMap comp;
+  comp[id("U235")] = 10;
+  comp[id("U238")] = 90;
+  comp[id("Pu239")] = 1;
+  comp[id("Pu240")] = 2;
+  comp[id("Am241")] = 3;
+  comp[id("Cs137")] = 4;
+  Composition::Ptr c = Composition::CreateFromMass(comp);
+  Material::Ptr mat = Material::CreateUntracked(100, c);
+
+  // nuclide efficiencies take precedence over element efficiencies within a
+  // stream, but not across streams
+  std::vector<std::map<int, double> > effs(3);
+  effs[0][id("U")] = .7;
+  effs[0][id("U235")] = .1;
+  effs[1][id("Pu")] = .4;
+  effs[1][id("U")] = .2;
+  effs[2][id("Pu239")] = .5;
+  effs[2][id("Am")] = 0;
+
+  SepMatrix sm(effs);
+  ASSERT_EQ(3, sm.nstreams());
+  std::vector<Material::Ptr> sep = sm.Split(mat);
+  ASSERT_EQ(3, sep.size());
+
+  const char* nucs[] = {"U235", "U238", "Pu239", "Pu240", "Am241", "Cs137"};
+  for (int s = 0; s < 3; ++s) {
+    Material::Ptr want = SepMaterial(effs[s], mat);
+    MatQuery mqwant(want);
+    MatQuery mqgot(sep[s]);
+    EXPECT_NEAR(want->quantity(), sep[s]->quantity(), 1e-10) << "stream " << s;
+    for (int i = 0; i < 6; ++i) {
+      EXPECT_NEAR(mqwant.mass(nucs[i]), mqgot.mass(nucs[i]), 1e-10)
+          << "stream " << s << " nuc " << nucs[i];
+    }
+  }
+
+  // feed with the same composition reuses the separated compositions
+  Material::Ptr half = Material::CreateUntracked(50, c);
+  std::vector<Material::Ptr> again = sm.Split(half);
+  for (int s = 0; s < 3; ++s) {
+    EXPECT_EQ(sep[s]->comp(), again[s]->comp());
+    EXPECT_NEAR(sep[s]->quantity() / 2, again[s]->quantity(), 1e-10);
+  }
+}
+
 // Check that cumulative separations efficiency for a single nuclide of less than or equal to one does not trigger an error.
 TEST(SeparationsTests, SeparationEfficiency) {
 
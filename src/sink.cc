@@ -1,9 +1,12 @@
 // Implements the Sink class
 #include <algorithm>
+#include <map>
 #include <sstream>
 
 #include <boost/lexical_cast.hpp>
 
+#include "compact_output.h"
+#include "memory_report.h"
 #include "sink.h"
 
 namespace cycamore {
@@ -12,9 +15,16 @@ namespace cycamore {
 Sink::Sink(cyclus::Context* ctx)
     : cyclus::Facility(ctx),
       capacity(std::numeric_limits<double>::max()),
+      inventory_mode("keep"),
+      min_request_qty(0),
+      request_resume_qty(0),
       latitude(0.0),
       longitude(0.0),
-      coordinates(latitude, longitude) {
+      compact_output(""),
+      profile_phases(false),
+      memory_report_period(0),
+      coordinates(latitude, longitude),
+      profile_(this, profile_phases) {
   SetMaxInventorySize(std::numeric_limits<double>::max());}
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -52,6 +62,13 @@ void Sink::EnterNotify() {
        << " values, expected " << in_commods.size();
     throw cyclus::ValueError(ss.str());
   }
+
+  if (inventory_mode != "keep" && inventory_mode != "by_comp" &&
+      inventory_mode != "squash") {
+    throw cyclus::ValueError("cycamore::Sink - invalid inventory_mode '" +
+                             inventory_mode +
+                             "', expected keep, by_comp or squash");
+  }
   RecordPosition();
 }
 
@@ -78,6 +95,7 @@ std::string Sink::str() {
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr>
 Sink::GetMatlRequests() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_REQUESTS);
   using cyclus::Material;
   using cyclus::RequestPortfolio;
   using cyclus::Request;
@@ -86,16 +104,14 @@ Sink::GetMatlRequests() {
   std::set<RequestPortfolio<Material>::Ptr> ports;
   RequestPortfolio<Material>::Ptr port(new RequestPortfolio<Material>());
   double amt = RequestAmt();
-  Material::Ptr mat;
-
-  if (recipe_name.empty()) {
-    mat = cyclus::NewBlankMaterial(amt);
-  } else {
-    Composition::Ptr rec = this->context()->GetRecipe(recipe_name);
-    mat = cyclus::Material::CreateUntracked(amt, rec); 
-  } 
+  bool open = req_gate_.Open(amt, min_request_qty, request_resume_qty);
 
-  if (amt > cyclus::eps()) {
+  if (amt > cyclus::eps() && open) {
+    Composition::Ptr c;
+    if (!recipe_name.empty()) {
+      c = context()->GetRecipe(recipe_name);
+    }
+    Material::Ptr mat = req_target_.Get(amt, c);
     std::vector<Request<Material>*> mutuals;
     for (int i = 0; i < in_commods.size(); i++) {
       mutuals.push_back(port->AddRequest(mat, this, in_commods[i], in_commod_prefs[i]));
@@ -104,6 +120,7 @@ Sink::GetMatlRequests() {
     ports.insert(port);
   }  // if amt > eps
 
+  profile_.Count(ports);
   return ports;
 }
 
@@ -119,8 +136,9 @@ Sink::GetGenRsrcRequests() {
   RequestPortfolio<Product>::Ptr
       port(new RequestPortfolio<Product>());
   double amt = RequestAmt();
+  bool open = req_gate_.Open(amt, min_request_qty, request_resume_qty);
 
-  if (amt > cyclus::eps()) {
+  if (amt > cyclus::eps() && open) {
     CapacityConstraint<Product> cc(amt);
     port->AddConstraint(cc);
 
@@ -141,11 +159,71 @@ Sink::GetGenRsrcRequests() {
 void Sink::AcceptMatlTrades(
     const std::vector< std::pair<cyclus::Trade<cyclus::Material>,
                                  cyclus::Material::Ptr> >& responses) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::ACCEPT_MATL_TRADES);
   std::vector< std::pair<cyclus::Trade<cyclus::Material>,
                          cyclus::Material::Ptr> >::const_iterator it;
+  if (inventory_mode == "keep") {
+    for (it = responses.begin(); it != responses.end(); ++it) {
+      inventory.Push(it->second);
+    }
+    return;
+  }
+
+  std::vector<cyclus::Material::Ptr> mats;
   for (it = responses.begin(); it != responses.end(); ++it) {
-    inventory.Push(it->second);
+    mats.push_back(it->second);
+  }
+  FoldMaterials_(mats);
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Sink::FoldMaterials_(const std::vector<cyclus::Material::Ptr>& mats) {
+  using cyclus::Material;
+  using cyclus::Resource;
+
+  if (mats.empty()) {
+    return;
+  }
+
+  bool squash = inventory_mode == "squash";
+  std::vector<Resource::Ptr> held;
+  if (squash) {
+    // products accepted since the last fold sit behind the aggregate; pop
+    // back to the last material and push it behind them so it stays last
+    std::vector<Resource::Ptr> products;
+    while (!inventory.empty()) {
+      Resource::Ptr r = inventory.PopBack();
+      if (r->type() == Material::kType) {
+        held.push_back(r);
+        break;
+      }
+      products.push_back(r);
+    }
+    held.insert(held.begin(), products.rbegin(), products.rend());
+  } else {
+    held = inventory.PopN(inventory.count());
+  }
+
+  // aggregate position in held by composition id (0 for squash)
+  std::map<int, int> index;
+  for (int i = 0; i < held.size(); ++i) {
+    if (held[i]->type() == Material::kType) {
+      Material::Ptr m = cyclus::ResCast<Material>(held[i]);
+      index[squash ? 0 : m->comp()->id()] = i;
+    }
+  }
+
+  for (int i = 0; i < mats.size(); ++i) {
+    int key = squash ? 0 : mats[i]->comp()->id();
+    std::map<int, int>::iterator it = index.find(key);
+    if (it == index.end()) {
+      index[key] = held.size();
+      held.push_back(mats[i]);
+    } else {
+      cyclus::ResCast<Material>(held[it->second])->Absorb(mats[i]);
+    }
   }
+  inventory.Push(held);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -161,6 +239,7 @@ void Sink::AcceptGenRsrcTrades(
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Sink::Tick() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::TICK);
   using std::string;
   using std::vector;
   LOG(cyclus::LEV_INFO3, "SnkFac") << prototype() << " is ticking {";
@@ -180,6 +259,7 @@ void Sink::Tick() {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Sink::Tock() {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::TOCK);
   LOG(cyclus::LEV_INFO3, "SnkFac") << prototype() << " is tocking {";
 
   // On the tock, the sink facility doesn't really do much.
@@ -189,19 +269,20 @@ void Sink::Tock() {
                                    << " is holding " << inventory.quantity()
                                    << " units of material at the close of month "
                                    << context()->time() << ".";
+  if (MemoryReport::Due(context(), memory_report_period)) {
+    MemoryReport::Record(this, "inventory", inventory);
+  }
   LOG(cyclus::LEV_INFO3, "SnkFac") << "}";
 }
 
+void Sink::Decommission() {
+  profile_.Flush();
+  cyclus::Facility::Decommission();
+}
+
 void Sink::RecordPosition() {
-  std::string specification = this->spec();
-  context()
-      ->NewDatum("AgentPosition")
-      ->AddVal("Spec", specification)
-      ->AddVal("Prototype", this->prototype())
-      ->AddVal("AgentId", id())
-      ->AddVal("Latitude", latitude)
-      ->AddVal("Longitude", longitude)
-      ->Record();
+  CompactOutput::RecordPosition(this, latitude, longitude,
+                                 compact_output);
 }
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
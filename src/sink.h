@@ -8,6 +8,9 @@
 
 #include "cyclus.h"
 #include "cycamore_version.h"
+#include "phase_profile.h"
+#include "request_gate.h"
+#include "request_target.h"
 
 namespace cycamore {
 
@@ -48,6 +51,8 @@ class Sink
 
   virtual void Tock();
 
+  virtual void Decommission();
+
   /// @brief SinkFacilities request Materials of their given commodity. Note
   /// that it is assumed the Sink operates on a single resource type!
   virtual std::set<cyclus::RequestPortfolio<cyclus::Material>::Ptr>
@@ -86,6 +91,13 @@ class Sink
   /// @return the current inventory storage size
   inline double InventorySize() const { return inventory.quantity(); }
 
+  /// @return the number of resource objects held in the inventory
+  inline int InventoryCount() const { return inventory.count(); }
+
+  /// sets how accepted materials are held (see inventory_mode)
+  /// @param mode one of "keep", "by_comp" or "squash"
+  inline void InventoryMode(std::string mode) { inventory_mode = mode; }
+
   /// determines the amount to request
   inline double RequestAmt() const {
     return std::min(capacity, std::max(0.0, inventory.space()));
@@ -98,6 +110,13 @@ class Sink
   /// @return the reception capacity at any given time step
   inline double Capacity() const { return capacity; }
 
+  /// sets the smallest request the sink makes and the amount of free
+  /// capacity at which requests resume once they have stopped
+  inline void MinRequest(double min_qty, double resume_qty) {
+    min_request_qty = min_qty;
+    request_resume_qty = resume_qty;
+  }
+
   /// @return the input commodities
   inline const std::vector<std::string>&
       input_commodities() const { return in_commods; }
@@ -150,6 +169,46 @@ class Sink
                              "accept at each time step"}
   double capacity;
 
+  #pragma cyclus var {"default": "keep", \
+                      "tooltip": "how accepted materials are held", \
+                      "uilabel": "Inventory Mode", \
+                      "categorical": ["keep", "by_comp", "squash"], \
+                      "doc": "how accepted materials are held in the " \
+                             "inventory. 'keep' (default) holds every " \
+                             "received material. 'by_comp' merges materials " \
+                             "into one aggregate per composition and " \
+                             "'squash' merges all of them into a single " \
+                             "aggregate, which keeps memory bounded for " \
+                             "terminal sinks such as repositories. " \
+                             "Quantities and capacity are unaffected.", \
+                      "userlevel": 10}
+  std::string inventory_mode;
+
+  #pragma cyclus var {"default": 0.0, \
+                      "tooltip": "smallest request the sink makes", \
+                      "uilabel": "Minimum Request Quantity", \
+                      "uitype": "range", \
+                      "range": [0.0, 1e299], \
+                      "units": "kg", \
+                      "doc": "the sink stops requesting material when it " \
+                             "can take less than this quantity in a time " \
+                             "step (e.g. when it is nearly full)", \
+                      "userlevel": 10}
+  double min_request_qty;
+
+  #pragma cyclus var {"default": 0.0, \
+                      "tooltip": "quantity at which requests resume", \
+                      "uilabel": "Request Resume Quantity", \
+                      "uitype": "range", \
+                      "range": [0.0, 1e299], \
+                      "units": "kg", \
+                      "doc": "once requests have stopped, the sink only " \
+                             "requests again when it can take at least " \
+                             "this quantity. Values below " \
+                             "min_request_qty resume at min_request_qty.", \
+                      "userlevel": 10}
+  double request_resume_qty;
+
   /// this facility holds material in storage.
   #pragma cyclus var {'capacity': 'max_inv_size'}
   cyclus::toolkit::ResBuf<cyclus::Resource> inventory;
@@ -170,9 +229,54 @@ class Sink
   }
   double longitude;
 
+  #pragma cyclus var { \
+    "default": "", \
+    "uilabel": "Compact Output Mode", \
+    "userlevel": 10, \
+    "doc": "Output mode for this agent's position. Empty or 'off' " \
+           "writes the regular tables. 'batches' writes the position to " \
+           "AgentPositionCompact, as does 'runs'.", \
+  }
+  std::string compact_output;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Profile Phases", \
+    "userlevel": 10, \
+    "doc": "If true, this facility records its call counts, wall time " \
+           "and bids or requests emitted for each phase of the time step. " \
+           "The whole-simulation totals are written to the AgentPhaseTimes " \
+           "table at the end of the simulation or when the facility is " \
+           "decommissioned.", \
+  }
+  bool profile_phases;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Memory Report Period", \
+    "userlevel": 10, \
+    "units": "time steps", \
+    "doc": "If positive, this facility writes one AgentMemory row per " \
+           "inventory buffer, with its resource and composition counts, " \
+           "quantity and estimated bytes, every memory_report_period time " \
+           "steps and on the last time step. 0 turns the report off.", \
+  }
+  int memory_report_period;
+
   cyclus::toolkit::Position coordinates;
 
   void RecordPosition();
+
+  /// merges mats into the inventory aggregates according to inventory_mode
+  void FoldMaterials_(const std::vector<cyclus::Material::Ptr>& mats);
+
+  /// request target reused across time steps
+  RequestTarget req_target_;
+
+  /// suppresses requests below min_request_qty
+  RequestGate req_gate_;
+
+  PhaseProfile profile_;
 };
 
 }  // namespace cycamore
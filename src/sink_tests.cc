@@ -139,6 +139,56 @@ TEST_F(SinkTest, Requests) {
   EXPECT_EQ(constraints.size(), 0);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(SinkTest, ReusedRequestTarget) {
+  using cyclus::Material;
+  using cyclus::RequestPortfolio;
+
+  src_facility->EnterNotify();
+  std::set<RequestPortfolio<Material>::Ptr> ports =
+      src_facility->GetMatlRequests();
+  ASSERT_EQ(1, ports.size());
+  Material::Ptr target = (*ports.begin())->requests()[0]->target();
+
+  // same amount requested, same target
+  ports = src_facility->GetMatlRequests();
+  ASSERT_EQ(1, ports.size());
+  EXPECT_EQ(target, (*ports.begin())->requests()[0]->target());
+
+  // a new amount gets a new target
+  src_facility->Capacity(capacity_ / 2);
+  ports = src_facility->GetMatlRequests();
+  ASSERT_EQ(1, ports.size());
+  Material::Ptr smaller = (*ports.begin())->requests()[0]->target();
+  EXPECT_NE(target, smaller);
+  EXPECT_DOUBLE_EQ(capacity_ / 2, smaller->quantity());
+}
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(SinkTest, MinRequest) {
+  using cyclus::Material;
+  using cyclus::RequestPortfolio;
+
+  src_facility->EnterNotify();
+  src_facility->MinRequest(capacity_ / 2, capacity_);
+
+  // enough room for a full request
+  EXPECT_EQ(1, src_facility->GetMatlRequests().size());
+
+  // too little room stops requests
+  src_facility->Capacity(capacity_ / 4);
+  EXPECT_TRUE(src_facility->GetMatlRequests().empty());
+
+  // above the minimum but short of the resume quantity
+  src_facility->Capacity(capacity_ * 3 / 4);
+  EXPECT_TRUE(src_facility->GetMatlRequests().empty());
+
+  src_facility->Capacity(capacity_);
+  EXPECT_EQ(1, src_facility->GetMatlRequests().size());
+  src_facility->Capacity(capacity_ * 3 / 4);
+  EXPECT_EQ(1, src_facility->GetMatlRequests().size());
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(SinkTest, EmptyRequests) {
   using cyclus::Material;
@@ -182,6 +232,69 @@ TEST_F(SinkTest, Accept) {
   src_facility->AcceptMatlTrades(responses);
   EXPECT_DOUBLE_EQ(qty, src_facility->InventorySize());
 }
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(SinkTest, InventoryModes) {
+  using cyclus::Bid;
+  using cyclus::Composition;
+  using cyclus::Material;
+  using cyclus::Request;
+  using cyclus::Trade;
+  using test_helpers::get_mat;
+
+  Composition::Ptr c = get_mat(922350000, 1)->comp();
+  Request<Material>* req =
+      Request<Material>::Create(get_mat(922350000, qty_), src_facility,
+                                commod1_);
+  Bid<Material>* bid = Bid<Material>::Create(req, get_mat(), trader);
+  Trade<Material> trade(req, bid, qty_);
+
+  std::vector< std::pair<cyclus::Trade<cyclus::Material>,
+                         cyclus::Material::Ptr> > responses;
+  responses.push_back(
+      std::make_pair(trade, Material::CreateUntracked(qty_ / 2, c)));
+  responses.push_back(
+      std::make_pair(trade, Material::CreateUntracked(qty_ / 2, c)));
+  responses.push_back(std::make_pair(trade, get_mat(922380000, qty_ / 2)));
+
+  // per composition aggregates
+  src_facility->InventoryMode("by_comp");
+  src_facility->AcceptMatlTrades(responses);
+  EXPECT_EQ(2, src_facility->InventoryCount());
+  responses.resize(1);
+  responses[0].second = Material::CreateUntracked(qty_ / 2, c);
+  src_facility->AcceptMatlTrades(responses);
+  EXPECT_EQ(2, src_facility->InventoryCount());
+  EXPECT_DOUBLE_EQ(2 * qty_, src_facility->InventorySize());
+
+  // everything in one aggregate, with exact capacity accounting
+  src_facility->InventoryMode("squash");
+  responses[0].second = get_mat(942390000, qty_ / 2);
+  src_facility->AcceptMatlTrades(responses);
+  EXPECT_EQ(2, src_facility->InventoryCount());
+  EXPECT_DOUBLE_EQ(2.5 * qty_, src_facility->InventorySize());
+  EXPECT_DOUBLE_EQ(inv_ - 2.5 * qty_, src_facility->RequestAmt());
+
+  // products accepted in between do not split the squashed aggregate
+  cyclus::Request<cyclus::Product>* preq =
+      cyclus::Request<cyclus::Product>::Create(
+          cyclus::Product::CreateUntracked(1, "bananas"), src_facility,
+          commod1_);
+  cyclus::Bid<cyclus::Product>* pbid = cyclus::Bid<cyclus::Product>::Create(
+      preq, cyclus::Product::CreateUntracked(1, "bananas"), trader);
+  std::vector< std::pair<cyclus::Trade<cyclus::Product>,
+                         cyclus::Product::Ptr> > presponses;
+  presponses.push_back(std::make_pair(
+      cyclus::Trade<cyclus::Product>(preq, pbid, 1),
+      cyclus::Product::CreateUntracked(1, "bananas")));
+  for (int i = 0; i < 2; ++i) {
+    src_facility->AcceptGenRsrcTrades(presponses);
+    responses[0].second = get_mat(942390000, qty_ / 2);
+    src_facility->AcceptMatlTrades(responses);
+  }
+  EXPECT_EQ(4, src_facility->InventoryCount());
+  EXPECT_DOUBLE_EQ(3.5 * qty_ + 2, src_facility->InventorySize());
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(SinkTest, InRecipe){
 // Create a context
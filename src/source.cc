@@ -1,19 +1,26 @@
 #include "source.h"
 
-#include <sstream>
 #include <limits>
+#include <sstream>
+#include <utility>
 
 #include <boost/lexical_cast.hpp>
 
+#include "compact_output.h"
+
 namespace cycamore {
 
 Source::Source(cyclus::Context* ctx)
     : cyclus::Facility(ctx),
       throughput(std::numeric_limits<double>::max()),
       inventory_size(std::numeric_limits<double>::max()),
+      constant_supply(false),
       latitude(0.0),
       longitude(0.0),
-      coordinates(latitude, longitude) {}
+      compact_output(""),
+      profile_phases(false),
+      coordinates(latitude, longitude),
+      profile_(this, profile_phases) {}
 
 Source::~Source() {}
 
@@ -31,6 +38,24 @@ void Source::InitFrom(cyclus::QueryableBackend* b) {
   RecordPosition();
 }
 
+void Source::EnterNotify() {
+  cyclus::Facility::EnterNotify();
+  if (constant_supply && outrecipe.empty()) {
+    throw cyclus::ValueError("Source " + prototype() + " cannot use "
+                             "constant_supply without an outrecipe");
+  }
+  if (!outrecipe.empty()) {
+    Recipe_();
+  }
+}
+
+cyclus::Composition::Ptr Source::Recipe_() {
+  if (!recipe_) {
+    recipe_ = context()->GetRecipe(outrecipe);
+  }
+  return recipe_;
+}
+
 std::string Source::str() {
   namespace tk = cyclus::toolkit;
   std::stringstream ss;
@@ -53,6 +78,7 @@ std::string Source::str() {
 
 std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> Source::GetMatlBids(
     cyclus::CommodMap<cyclus::Material>::type& commod_requests) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_BIDS);
   using cyclus::Bid;
   using cyclus::BidPortfolio;
   using cyclus::CapacityConstraint;
@@ -74,20 +100,29 @@ std::set<cyclus::BidPortfolio<cyclus::Material>::Ptr> Source::GetMatlBids(
   BidPortfolio<Material>::Ptr port(new BidPortfolio<Material>());
   std::vector<Request<Material>*>& requests = commod_requests[outcommod];
   std::vector<Request<Material>*>::iterator it;
-  for (it = requests.begin(); it != requests.end(); ++it) {
-    Request<Material>* req = *it;
-    Material::Ptr target = req->target();
-    double qty = std::min(target->quantity(), max_qty);
-    Material::Ptr m = Material::CreateUntracked(qty, target->comp());
-    if (!outrecipe.empty()) {
-      m = Material::CreateUntracked(qty, context()->GetRecipe(outrecipe));
+  if (constant_supply) {
+    // one offer covers every request, the capacity constraint does the rest
+    Material::Ptr m = offer_pool_.Get(max_qty, Recipe_());
+    for (it = requests.begin(); it != requests.end(); ++it) {
+      port->AddBid(*it, m, this);
+    }
+  } else {
+    // requests asking for the same quantity of the same composition get the
+    // same offer
+    for (it = requests.begin(); it != requests.end(); ++it) {
+      Request<Material>* req = *it;
+      Material::Ptr target = req->target();
+      double qty = std::min(target->quantity(), max_qty);
+      cyclus::Composition::Ptr c =
+          outrecipe.empty() ? target->comp() : Recipe_();
+      port->AddBid(req, offer_pool_.Get(qty, c), this);
     }
-    port->AddBid(req, m, this);
   }
 
   CapacityConstraint<Material> cc(max_qty);
   port->AddConstraint(cc);
   ports.insert(port);
+  profile_.Count(ports);
   return ports;
 }
 
@@ -95,6 +130,7 @@ void Source::GetMatlTrades(
     const std::vector<cyclus::Trade<cyclus::Material> >& trades,
     std::vector<std::pair<cyclus::Trade<cyclus::Material>,
                           cyclus::Material::Ptr> >& responses) {
+  PhaseProfile::Scope scope(&profile_, PhaseProfile::GET_MATL_TRADES);
   using cyclus::Material;
   using cyclus::Trade;
 
@@ -105,7 +141,7 @@ void Source::GetMatlTrades(
 
     Material::Ptr response;
     if (!outrecipe.empty()) {
-      response = Material::Create(this, qty, context()->GetRecipe(outrecipe));
+      response = Material::Create(this, qty, Recipe_());
     } else {
       response = Material::Create(this, qty, it->request->target()->comp());
     }
@@ -116,15 +152,8 @@ void Source::GetMatlTrades(
 }
 
 void Source::RecordPosition() {
-  std::string specification = this->spec();
-  context()
-      ->NewDatum("AgentPosition")
-      ->AddVal("Spec", specification)
-      ->AddVal("Prototype", this->prototype())
-      ->AddVal("AgentId", id())
-      ->AddVal("Latitude", latitude)
-      ->AddVal("Longitude", longitude)
-      ->Record();
+  CompactOutput::RecordPosition(this, latitude, longitude,
+                                 compact_output);
 }
 
 extern "C" cyclus::Agent* ConstructSource(cyclus::Context* ctx) {
@@ -6,6 +6,8 @@
 
 #include "cyclus.h"
 #include "cycamore_version.h"
+#include "material_pool.h"
+#include "phase_profile.h"
 
 namespace cycamore {
 
@@ -57,9 +59,19 @@ class Source : public cyclus::Facility,
 
   virtual void InitFrom(cyclus::QueryableBackend* b);
 
+  virtual void EnterNotify();
+
   virtual void Tick() {};
 
-  virtual void Tock() {};
+  virtual void Tock() {
+    PhaseProfile::Scope scope(&profile_, PhaseProfile::TOCK);
+    offer_pool_.Reset();
+  };
+
+  virtual void Decommission() {
+    profile_.Flush();
+    cyclus::Facility::Decommission();
+  };
 
   virtual std::string str();
 
@@ -115,7 +127,20 @@ class Source : public cyclus::Facility,
     "doc": "amount of commodity that can be supplied at each time step", \
   }
   double throughput;
-  
+
+  #pragma cyclus var { \
+    "default": False, \
+    "userlevel": 10, \
+    "tooltip": "offer the full throughput to every request", \
+    "uilabel": "Constant Supply", \
+    "doc": "If true, the source offers its whole per time step capacity " \
+           "as one material that is shared by the bids on all requests, " \
+           "and the capacity constraint splits it among them.  This " \
+           "requires an output recipe.  If false, each request is offered " \
+           "up to its requested quantity.", \
+  }
+  bool constant_supply;
+
   #pragma cyclus var { \
     "default": 0.0, \
     "uilabel": "Geographical latitude in degrees as a double", \
@@ -132,9 +157,44 @@ class Source : public cyclus::Facility,
   }
   double longitude;
 
+  #pragma cyclus var { \
+    "default": "", \
+    "uilabel": "Compact Output Mode", \
+    "userlevel": 10, \
+    "doc": "Output mode for this agent's position. Empty or 'off' " \
+           "writes the regular tables. 'batches' writes the position to " \
+           "AgentPositionCompact, as does 'runs'.", \
+  }
+  std::string compact_output;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Profile Phases", \
+    "userlevel": 10, \
+    "doc": "If true, this facility records its call counts, wall time " \
+           "and bids or requests emitted for each phase of the time step. " \
+           "The whole-simulation totals are written to the AgentPhaseTimes " \
+           "table at the end of the simulation or when the facility is " \
+           "decommissioned.", \
+  }
+  bool profile_phases;
+
   cyclus::toolkit::Position coordinates;
 
   void RecordPosition();
+
+  /// Returns the output recipe composition, looking it up in the context the
+  /// first time it is needed.
+  cyclus::Composition::Ptr Recipe_();
+
+  /// Cached output recipe composition, null until first used.
+  cyclus::Composition::Ptr recipe_;
+
+  /// bid offers of the current time step, shared by all requests for the
+  /// same quantity of the same composition
+  MaterialPool offer_pool_;
+
+  PhaseProfile profile_;
 };
 
 }  // namespace cycamore
@@ -80,6 +80,54 @@ TEST_F(SourceTest, AddBids) {
   EXPECT_EQ(*constrs.begin(), CapacityConstraint<Material>(capacity));
 }
 
+TEST_F(SourceTest, SharedOffers) {
+  using cyclus::BidPortfolio;
+  using cyclus::Material;
+
+  int nreqs = 5;
+  boost::shared_ptr< cyclus::ExchangeContext<Material> >
+      ec = GetContext(nreqs, commod);
+
+  // all requests ask for the same quantity and get the recipe
+  std::set<BidPortfolio<Material>::Ptr> ports =
+      src_facility->GetMatlBids(ec.get()->commod_requests);
+  ASSERT_EQ(1, ports.size());
+  const std::set<cyclus::Bid<Material>*>& bids = (*ports.begin())->bids();
+  ASSERT_EQ(nreqs, bids.size());
+  Material::Ptr offer = (*bids.begin())->offer();
+  EXPECT_EQ(recipe, offer->comp());
+  std::set<cyclus::Bid<Material>*>::const_iterator it;
+  for (it = bids.begin(); it != bids.end(); ++it) {
+    EXPECT_EQ(offer, (*it)->offer());
+  }
+}
+
+TEST_F(SourceTest, ConstantSupply) {
+  using cyclus::BidPortfolio;
+  using cyclus::Material;
+
+  constant_supply(src_facility, true);
+  int nreqs = 5;
+  boost::shared_ptr< cyclus::ExchangeContext<Material> >
+      ec = GetContext(nreqs, commod);
+
+  std::set<BidPortfolio<Material>::Ptr> ports =
+      src_facility->GetMatlBids(ec.get()->commod_requests);
+  ASSERT_EQ(1, ports.size());
+  BidPortfolio<Material>::Ptr port = *ports.begin();
+  ASSERT_EQ(nreqs, port->bids().size());
+  EXPECT_EQ(cyclus::CapacityConstraint<Material>(capacity),
+            *port->constraints().begin());
+
+  Material::Ptr offer = (*port->bids().begin())->offer();
+  EXPECT_DOUBLE_EQ(capacity, offer->quantity());
+  EXPECT_EQ(recipe, offer->comp());
+  std::set<cyclus::Bid<Material>*>::const_iterator it;
+  for (it = port->bids().begin(); it != port->bids().end(); ++it) {
+    EXPECT_EQ(offer, (*it)->offer());
+  }
+}
+
 TEST_F(SourceTest, Response) {
   using cyclus::Bid;
   using cyclus::Material;
@@ -39,6 +39,9 @@ class SourceTest : public ::testing::Test {
     s->outcommod = commod;
   }
   void throughput(cycamore::Source* s, double val) { s->throughput = val; }
+  void constant_supply(cycamore::Source* s, bool val) {
+    s->constant_supply = val;
+  }
 
   boost::shared_ptr<cyclus::ExchangeContext<cyclus::Material> > GetContext(
       int nreqs, std::string commodity);
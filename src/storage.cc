@@ -2,14 +2,24 @@
 // Implements the Storage class
 #include "storage.h"
 
+#include "compact_output.h"
+#include "memory_report.h"
+
 namespace storage {
 
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 Storage::Storage(cyclus::Context* ctx) 
     : cyclus::Facility(ctx),
+      coalesce_materials(false),
+      min_request_qty(0),
+      request_resume_qty(0),
       latitude(0.0),
       longitude(0.0),
-      coordinates(latitude, longitude) {
+      compact_output(""),
+      profile_phases(false),
+      memory_report_period(0),
+      coordinates(latitude, longitude),
+      profile_(this, profile_phases) {
   cyclus::Warn<cyclus::EXPERIMENTAL_WARNING>(
       "The Storage Facility is experimental.");};
 
@@ -74,6 +84,11 @@ void Storage::EnterNotify() {
   }
   buy_policy.Start();
 
+  if (coalesce_materials && discrete_handling) {
+    throw cyclus::ValueError(
+        "coalesce_materials cannot be used with discrete_handling");
+  }
+
   if (out_commods.size() == 1) {
     sell_policy.Init(this, &stocks, std::string("stocks"))
         .Set(out_commods.front())
@@ -114,8 +129,15 @@ std::string Storage::str() {
 
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Storage::Tick() {
-  // Set available capacity for Buy Policy
-  inventory.capacity(current_capacity());
+  cycamore::PhaseProfile::Scope scope(&profile_, cycamore::PhaseProfile::TICK);
+  // Set available capacity for Buy Policy, leaving no space to request
+  // while there is too little room for a worthwhile request
+  double space = current_capacity() - inventory.quantity();
+  if (req_gate_.Open(space, min_request_qty, request_resume_qty)) {
+    inventory.capacity(current_capacity());
+  } else {
+    inventory.capacity(inventory.quantity());
+  }
 
   LOG(cyclus::LEV_INFO3, "ComCnv") << prototype() << " is ticking {";
 
@@ -128,6 +150,7 @@ void Storage::Tick() {
 
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Storage::Tock() {
+  cycamore::PhaseProfile::Scope scope(&profile_, cycamore::PhaseProfile::TOCK);
   LOG(cyclus::LEV_INFO3, "ComCnv") << prototype() << " is tocking {";
 
   BeginProcessing_();  // place unprocessed inventory into processing
@@ -138,9 +161,22 @@ void Storage::Tock() {
 
   ProcessMat_(throughput);  // place ready into stocks
 
+  if (cycamore::MemoryReport::Due(context(), memory_report_period)) {
+    cycamore::MemoryReport::Record(this, "inventory", inventory);
+    cycamore::MemoryReport::Record(this, "processing", processing);
+    cycamore::MemoryReport::Record(this, "ready", ready);
+    cycamore::MemoryReport::Record(this, "stocks", stocks);
+  }
+
   LOG(cyclus::LEV_INFO3, "ComCnv") << "}";
 }
 
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Storage::Decommission() {
+  profile_.Flush();
+  cyclus::Facility::Decommission();
+}
+
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Storage::AddMat_(cyclus::Material::Ptr mat) {
   LOG(cyclus::LEV_INFO5, "ComCnv") << prototype() << " is initially holding "
@@ -161,18 +197,49 @@ void Storage::AddMat_(cyclus::Material::Ptr mat) {
 
 //- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 void Storage::BeginProcessing_() {
-  while (inventory.count() > 0) {
-    try {
-      processing.Push(inventory.Pop());
-      entry_times.push_back(context()->time());
+  using cyclus::Material;
+  using cyclus::toolkit::MatVec;
 
-      LOG(cyclus::LEV_DEBUG2, "ComCnv")
-          << "Storage " << prototype()
-          << " added resources to processing at t= " << context()->time();
-    } catch (cyclus::Error& e) {
-      e.msg(Agent::InformErrorMsg(e.msg()));
-      throw e;
+  if (inventory.empty()) {
+    return;
+  }
+  SyncEntryCounts_();
+
+  int t = context()->time();
+  bool same_batch = !entry_times.empty() && entry_times.back() == t;
+  try {
+    if (discrete_handling) {
+      MatVec mats = inventory.PopN(inventory.count());
+      processing.Push(mats);
+      if (same_batch) {
+        entry_counts.back() += mats.size();
+      } else {
+        entry_times.push_back(t);
+        entry_counts.push_back(mats.size());
+      }
+    } else {
+      Material::Ptr batch =
+          cyclus::toolkit::Squash(inventory.PopN(inventory.count()));
+      if (same_batch && entry_counts.back() == 1) {
+        Material::Ptr last =
+            cyclus::ResCast<Material>(processing.PopBack());
+        last->Absorb(batch);
+        batch = last;
+      } else if (same_batch) {
+        entry_counts.back() += 1;
+      } else {
+        entry_times.push_back(t);
+        entry_counts.push_back(1);
+      }
+      processing.Push(batch);
     }
+
+    LOG(cyclus::LEV_DEBUG2, "ComCnv")
+        << "Storage " << prototype()
+        << " added resources to processing at t= " << t;
+  } catch (cyclus::Error& e) {
+    e.msg(Agent::InformErrorMsg(e.msg()));
+    throw e;
   }
 }
 
@@ -198,7 +265,7 @@ void Storage::ProcessMat_(double cap) {
           }
         }
       } else {
-        stocks.Push(ready.Pop(max_pop, cyclus::eps_rsrc()));
+        PushCoalesced_(stocks, ready.Pop(max_pop, cyclus::eps_rsrc()));
       }
 
       LOG(cyclus::LEV_INFO1, "ComCnv") << "Storage " << prototype()
@@ -216,26 +283,50 @@ void Storage::ProcessMat_(double cap) {
 void Storage::ReadyMatl_(int time) {
   using cyclus::toolkit::ResBuf;
 
-  int to_ready = 0;
+  SyncEntryCounts_();
 
+  int to_ready = 0;
   while (!entry_times.empty() && entry_times.front() <= time) {
     entry_times.pop_front();
-    ++to_ready;
+    to_ready += entry_counts.front();
+    entry_counts.pop_front();
+  }
+
+  if (to_ready > 0) {
+    cyclus::toolkit::MatVec mats = processing.PopN(to_ready);
+    for (int i = 0; i < mats.size(); ++i) {
+      PushCoalesced_(ready, mats[i]);
+    }
   }
+}
+
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Storage::PushCoalesced_(cyclus::toolkit::ResBuf<cyclus::Material>& buf,
+                             cyclus::Material::Ptr mat) {
+  using cyclus::Material;
+
+  if (coalesce_materials && !buf.empty()) {
+    Material::Ptr last = cyclus::ResCast<Material>(buf.PopBack());
+    if (last->comp() == mat->comp()) {
+      last->Absorb(mat);
+      mat = last;
+    } else {
+      buf.Push(last);
+    }
+  }
+  buf.Push(mat);
+}
 
-  ready.Push(processing.PopN(to_ready));
+//- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+void Storage::SyncEntryCounts_() {
+  while (entry_counts.size() < entry_times.size()) {
+    entry_counts.push_back(1);
+  }
 }
 
 void Storage::RecordPosition() {
-  std::string specification = this->spec();
-  context()
-      ->NewDatum("AgentPosition")
-      ->AddVal("Spec", specification)
-      ->AddVal("Prototype", this->prototype())
-      ->AddVal("AgentId", id())
-      ->AddVal("Latitude", latitude)
-      ->AddVal("Longitude", longitude)
-      ->Record();
+  cycamore::CompactOutput::RecordPosition(this, latitude, longitude,
+                                          compact_output);
 }
 
 
@@ -6,6 +6,8 @@
 #include <vector>
 
 #include "cyclus.h"
+#include "phase_profile.h"
+#include "request_gate.h"
 
 // forward declaration
 namespace storage {
@@ -99,13 +101,18 @@ class Storage
   /// The handleTick function specific to the Storage.
   virtual void Tock();
 
+  /// Writes the phase profile totals before leaving the simulation.
+  virtual void Decommission();
+
  protected:
   ///   @brief adds a material into the incoming commodity inventory
   ///   @param mat the material to add to the incoming inventory.
   ///   @throws if there is trouble with pushing to the inventory buffer.
   void AddMat_(cyclus::Material::Ptr mat);
 
-  /// @brief Move all unprocessed inventory to processing
+  /// @brief Move all unprocessed inventory to processing as one batch for
+  /// the current time step, squashed into a single material unless
+  /// discrete_handling is set
   void BeginProcessing_();
 
   /// @brief Move as many ready resources as allowable into stocks
@@ -116,6 +123,15 @@ class Storage
   /// @param time the time of interest
   void ReadyMatl_(int time);
 
+  /// @brief pushes mat onto buf, merging it into the last material of buf if
+  /// coalesce_materials is set and they share a composition
+  void PushCoalesced_(cyclus::toolkit::ResBuf<cyclus::Material>& buf,
+                      cyclus::Material::Ptr mat);
+
+  /// @brief pads entry_counts to match entry_times, for state that only
+  /// recorded one entry time per material
+  void SyncEntryCounts_();
+
     /* --- Storage Members --- */
 
   /// @brief current maximum amount that can be added to processing
@@ -191,6 +207,40 @@ class Storage
                       "uilabel":"Batch Handling"}
   bool discrete_handling;                    
 
+  #pragma cyclus var {"default": False,\
+                      "tooltip":"Bool to merge same-composition materials",\
+                      "doc":"If true, materials entering the ready and stocks buffers are merged "\
+                            "into the last material in the buffer when they share its composition, "\
+                            "so long-lived storage holds few large materials instead of many small "\
+                            "ones. Cannot be combined with discrete handling. Default to false.",\
+                      "uilabel":"Coalesce Materials",\
+                      "userlevel": 10}
+  bool coalesce_materials;
+
+  #pragma cyclus var {"default": 0.0,\
+                      "tooltip":"minimum request quantity (kg)",\
+                      "doc":"Storage stops requesting material while it has room for less than "\
+                            "this quantity, so a nearly full facility does not put negligible "\
+                            "requests on the exchange. Default to 0 (always request).",\
+                      "uilabel":"Minimum Request Quantity",\
+                      "uitype": "range", \
+                      "range": [0.0, 1e299], \
+                      "units":"kg",\
+                      "userlevel": 10}
+  double min_request_qty;
+
+  #pragma cyclus var {"default": 0.0,\
+                      "tooltip":"request resume quantity (kg)",\
+                      "doc":"Once requests have stopped, Storage requests again only when it has "\
+                            "room for at least this quantity. Values below min_request_qty resume "\
+                            "at min_request_qty.",\
+                      "uilabel":"Request Resume Quantity",\
+                      "uitype": "range", \
+                      "range": [0.0, 1e299], \
+                      "units":"kg",\
+                      "userlevel": 10}
+  double request_resume_qty;
+
   #pragma cyclus var {"tooltip":"Incoming material buffer"}
   cyclus::toolkit::ResBuf<cyclus::Material> inventory;
 
@@ -200,11 +250,18 @@ class Storage
   #pragma cyclus var {"tooltip":"Buffer for material held for required residence_time"}
   cyclus::toolkit::ResBuf<cyclus::Material> ready;
 
-  //// list of input times for materials entering the processing buffer
+  //// list of input times for the batches in the processing buffer, one
+  //// entry per time step in which material entered processing
   #pragma cyclus var{"default": [],\
                       "internal": True}
   std::list<int> entry_times;
 
+  //// number of materials in the processing buffer for each entry in
+  //// entry_times (missing counts are 1, one material per entry time)
+  #pragma cyclus var{"default": [],\
+                      "internal": True}
+  std::list<int> entry_counts;
+
   #pragma cyclus var {"tooltip":"Buffer for material still waiting for required residence_time"}
   cyclus::toolkit::ResBuf<cyclus::Material> processing;
 
@@ -214,6 +271,9 @@ class Storage
   //// A policy for sending material
   cyclus::toolkit::MatlSellPolicy sell_policy;
 
+  //// Closes the buy policy while there is less room than min_request_qty
+  cycamore::RequestGate req_gate_;
+
   #pragma cyclus var { \
     "default": 0.0, \
     "uilabel": "Geographical latitude in degrees as a double", \
@@ -230,11 +290,48 @@ class Storage
   }
   double longitude;
 
+  #pragma cyclus var { \
+    "default": "", \
+    "uilabel": "Compact Output Mode", \
+    "userlevel": 10, \
+    "doc": "Output mode for this agent's position. Empty or 'off' " \
+           "writes the regular tables. 'batches' writes the position to " \
+           "AgentPositionCompact, as does 'runs'.", \
+  }
+  std::string compact_output;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Profile Phases", \
+    "userlevel": 10, \
+    "doc": "If true, this facility records its call counts, wall time " \
+           "and bids or requests emitted for each phase of the time step. " \
+           "The whole-simulation totals are written to the AgentPhaseTimes " \
+           "table at the end of the simulation or when the facility is " \
+           "decommissioned.", \
+  }
+  bool profile_phases;
+
+  #pragma cyclus var { \
+    "default": 0, \
+    "uilabel": "Memory Report Period", \
+    "userlevel": 10, \
+    "units": "time steps", \
+    "doc": "If positive, this facility writes one AgentMemory row per " \
+           "inventory buffer, with its resource and composition counts, " \
+           "quantity and estimated bytes, every memory_report_period time " \
+           "steps and on the last time step. 0 turns the report off.", \
+  }
+  int memory_report_period;
+
   cyclus::toolkit::Position coordinates;
 
   void RecordPosition();
 
   friend class StorageTest;
+  friend class StorageBench;
+
+  cycamore::PhaseProfile profile_;
 };
 
 }  // namespace storage
@@ -23,6 +23,7 @@ void StorageTest::InitParameters(){
   max_inv_size = 200;
   throughput = 20;
   discrete_handling = 0;
+  coalesce_materials = 0;
 
   cyclus::CompMap v;
   v[922350000] = 1;
@@ -39,6 +40,7 @@ void StorageTest::SetUpStorage(){
   src_facility_->max_inv_size = max_inv_size;
   src_facility_->throughput = throughput;
   src_facility_->discrete_handling = discrete_handling;
+  src_facility_->coalesce_materials = coalesce_materials;
 }
 
 void StorageTest::TestInitState(Storage* fac){
@@ -81,6 +83,23 @@ void StorageTest::TestCurrentCap(Storage* fac, double inv){
   EXPECT_EQ(inv, fac->current_capacity());
 }
 
+void StorageTest::TestBatches(Storage* fac, int n_batches, int n_proc){
+
+  EXPECT_EQ(n_batches, fac->entry_times.size());
+  EXPECT_EQ(n_proc, fac->processing.count());
+}
+
+void StorageTest::TestCounts(Storage* fac, int n_ready, int n_stocks){
+
+  EXPECT_EQ(n_ready, fac->ready.count());
+  EXPECT_EQ(n_stocks, fac->stocks.count());
+}
+
+void StorageTest::TestSpace(Storage* fac, double space){
+
+  EXPECT_DOUBLE_EQ(space, fac->inventory.space());
+}
+
 void StorageTest::TestReadyTime(Storage* fac, int t){
 
   EXPECT_EQ(t, fac->ready_time());
@@ -99,6 +118,29 @@ TEST_F(StorageTest, InitialState) {
   TestInitState(src_facility_);
 }
 
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+TEST_F(StorageTest, MinRequest){
+  src_facility_->min_request_qty = 50;
+  src_facility_->request_resume_qty = 100;
+  double cap = max_inv_size;
+
+  src_facility_->Tick();
+  TestSpace(src_facility_, cap);
+
+  // room for less than the minimum closes the buy policy
+  src_facility_->AddMat_(cyclus::NewBlankMaterial(cap - 40));
+  src_facility_->Tick();
+  TestSpace(src_facility_, 0);
+
+  // and it stays closed until there is room for the resume quantity
+  src_facility_->inventory.Pop(40, cyclus::eps_rsrc());
+  src_facility_->Tick();
+  TestSpace(src_facility_, 0);
+  src_facility_->inventory.Pop(30, cyclus::eps_rsrc());
+  src_facility_->Tick();
+  TestSpace(src_facility_, 110);
+}
+
 // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 TEST_F(StorageTest, CurrentCapacity){
   TestCurrentCap(src_facility_,max_inv_size);
@@ -321,6 +363,88 @@ TEST_F(StorageTest, TwoBatchSameTime) {
   TestBuffers(src_facility_,0,0,0,0.4*cap);
 }
 
+TEST_F(StorageTest, BatchedProcessing) {
+  // continuous handling squashes each time step's arrivals into one batch
+  double cap = throughput;
+  cyclus::Composition::Ptr rec = tc_.get()->GetRecipe(in_r1);
+  for (int i = 0; i < 3; ++i) {
+    TestAddMat(src_facility_,
+               cyclus::Material::CreateUntracked(0.1*cap, rec));
+  }
+  EXPECT_NO_THROW(src_facility_->Tock());
+  TestBatches(src_facility_, 1, 1);
+
+  // later arrivals in the same time step join the same batch
+  TestAddMat(src_facility_, cyclus::Material::CreateUntracked(0.1*cap, rec));
+  EXPECT_NO_THROW(src_facility_->Tock());
+  TestBatches(src_facility_, 1, 1);
+  TestBuffers(src_facility_,0,0.4*cap,0,0);
+
+  // discrete handling keeps the materials but still tracks one entry time
+  tc_.get()->time(1);
+  discrete_handling = 1;
+  SetUpStorage();
+  for (int i = 0; i < 2; ++i) {
+    TestAddMat(src_facility_,
+               cyclus::Material::CreateUntracked(0.1*cap, rec));
+  }
+  EXPECT_NO_THROW(src_facility_->Tock());
+  TestBatches(src_facility_, 2, 3);
+
+  tc_.get()->time(residence_time);
+  EXPECT_NO_THROW(src_facility_->Tock());
+  TestBatches(src_facility_, 1, 2);
+  TestBuffers(src_facility_,0,0.2*cap,0,0.4*cap);
+
+  tc_.get()->time(residence_time+1);
+  EXPECT_NO_THROW(src_facility_->Tock());
+  TestBatches(src_facility_, 0, 0);
+  TestBuffers(src_facility_,0,0,0,0.6*cap);
+}
+
+TEST_F(StorageTest, CoalesceMaterials) {
+  // three batches of the same recipe end up as a single stocks material
+  coalesce_materials = 1;
+  SetUpStorage();
+  double cap = throughput;
+  cyclus::Composition::Ptr rec = tc_.get()->GetRecipe(in_r1);
+  for (int t = 0; t < 3; ++t) {
+    tc_.get()->time(t);
+    TestAddMat(src_facility_,
+               cyclus::Material::CreateUntracked(0.1*cap, rec));
+    EXPECT_NO_THROW(src_facility_->Tock());
+  }
+  for (int t = residence_time; t < residence_time + 3; ++t) {
+    tc_.get()->time(t);
+    EXPECT_NO_THROW(src_facility_->Tock());
+  }
+  TestBuffers(src_facility_,0,0,0,0.1*cap+0.1*cap+0.1*cap);
+  TestCounts(src_facility_, 0, 1);
+}
+
+TEST_F(StorageTest, CoalesceDifferentRecipes) {
+  // materials with different compositions are never merged
+  coalesce_materials = 1;
+  SetUpStorage();
+  double cap = throughput;
+  cyclus::CompMap v;
+  v[922350000] = 3;
+  v[922380000] = 1;
+  cyclus::Composition::Ptr rec1 = tc_.get()->GetRecipe(in_r1);
+  cyclus::Composition::Ptr rec2 = cyclus::Composition::CreateFromAtom(v);
+  TestAddMat(src_facility_, cyclus::Material::CreateUntracked(0.1*cap, rec1));
+  EXPECT_NO_THROW(src_facility_->Tock());
+  tc_.get()->time(1);
+  TestAddMat(src_facility_, cyclus::Material::CreateUntracked(0.1*cap, rec2));
+  EXPECT_NO_THROW(src_facility_->Tock());
+
+  tc_.get()->time(residence_time);
+  EXPECT_NO_THROW(src_facility_->Tock());
+  tc_.get()->time(residence_time+1);
+  EXPECT_NO_THROW(src_facility_->Tock());
+  TestCounts(src_facility_, 0, 2);
+}
+
 TEST_F(StorageTest,ChangeProcessTime){
   // Initialize process time variable and add first batch
   int proc_time1 = residence_time;
@@ -28,13 +28,16 @@ class StorageTest : public ::testing::Test {
   void TestStocks(storage::Storage* fac, cyclus::CompMap v);
   void TestReadyTime(storage::Storage* fac, int t);
   void TestCurrentCap(storage::Storage* fac, double inv);
+  void TestBatches(storage::Storage* fac, int n_batches, int n_proc);
+  void TestCounts(storage::Storage* fac, int n_ready, int n_stocks);
+  void TestSpace(storage::Storage* fac, double space);
 
   std::vector<std::string> in_c1, out_c1;
   std::string in_r1;
 
   int residence_time;
   double throughput, max_inv_size;
-  bool discrete_handling;
+  bool discrete_handling, coalesce_materials;
 };
 } // namespace storage
 #endif // STORAGE_TESTS_H_
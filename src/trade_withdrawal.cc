@@ -0,0 +1,42 @@
+#include "trade_withdrawal.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+namespace cycamore {
+
+cyclus::toolkit::MatVec WithdrawTrades(
+    cyclus::toolkit::ResBuf<cyclus::Material>& buf,
+    const std::vector<double>& qtys) {
+  cyclus::toolkit::MatVec out;
+  if (qtys.empty()) {
+    return out;
+  }
+
+  double tot = 0;
+  for (int i = 0; i < qtys.size(); ++i) {
+    tot += qtys[i];
+  }
+
+  if (tot > buf.quantity() + cyclus::eps_rsrc()) {
+    std::stringstream ss;
+    ss << "trades for " << tot << " kg exceed the " << buf.quantity()
+       << " kg held in the buffer";
+    throw cyclus::ValueError(ss.str());
+  }
+
+  for (int i = 0; i < qtys.size(); ++i) {
+    bool last = i + 1 == qtys.size();
+    if (last && buf.count() > 0 &&
+        std::abs(qtys[i] - buf.quantity()) <= cyclus::eps_rsrc()) {
+      out.push_back(cyclus::toolkit::Squash(buf.PopN(buf.count())));
+    } else {
+      out.push_back(buf.Pop(std::min(qtys[i], buf.quantity()),
+                            cyclus::eps_rsrc()));
+    }
+  }
+  return out;
+}
+
+}  // namespace cycamore
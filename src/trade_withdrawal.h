@@ -0,0 +1,25 @@
+#ifndef CYCAMORE_SRC_TRADE_WITHDRAWAL_H_
+#define CYCAMORE_SRC_TRADE_WITHDRAWAL_H_
+
+#include <vector>
+
+#include "cyclus.h"
+
+namespace cycamore {
+
+/// Withdraws the materials for the trades drawn from buf, given their amounts
+/// in trade order in qtys, and returns one material per amount.  Callers
+/// resolve all trades on a buffer once and hand them over together.  Each
+/// trade is popped in turn from the front of the buffer, so it gets the same
+/// materials as popping the trades one by one.  The last trade takes the
+/// whole remainder without a split when it matches the buffer contents
+/// (within eps_rsrc), so a trade for all of a one-material buffer gets that
+/// very material.  Throws a ValueError if the trades add up to more than the
+/// buffer holds.
+cyclus::toolkit::MatVec WithdrawTrades(
+    cyclus::toolkit::ResBuf<cyclus::Material>& buf,
+    const std::vector<double>& qtys);
+
+}  // namespace cycamore
+
+#endif  // CYCAMORE_SRC_TRADE_WITHDRAWAL_H_
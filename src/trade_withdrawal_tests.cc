@@ -0,0 +1,61 @@
+#include "trade_withdrawal.h"
+
+#include <gtest/gtest.h>
+
+using cyclus::CompMap;
+using cyclus::Composition;
+using cyclus::Material;
+
+namespace cycamore {
+
+namespace {
+
+Composition::Ptr Uranium(double assay) {
+  CompMap m;
+  m[922350000] = assay;
+  m[922380000] = 1 - assay;
+  return Composition::CreateFromMass(m);
+}
+
+}  // namespace
+
+TEST(TradeWithdrawalTests, WithdrawTrades) {
+  cyclus::toolkit::ResBuf<Material> buf;
+  Material::Ptr whole = Material::CreateUntracked(5, Uranium(0.04));
+  buf.Push(whole);
+
+  // a single trade for the whole buffer gets the buffered material itself
+  std::vector<double> qtys(1, 5);
+  cyclus::toolkit::MatVec mats = WithdrawTrades(buf, qtys);
+  ASSERT_EQ(1, mats.size());
+  EXPECT_EQ(whole, mats[0]);
+  EXPECT_EQ(0, buf.count());
+
+  // partial trades are popped from the front in trade order and the rest
+  // stays buffered
+  Composition::Ptr leu = Uranium(0.04);
+  Composition::Ptr heu = Uranium(0.9);
+  buf.Push(Material::CreateUntracked(4, leu));
+  buf.Push(Material::CreateUntracked(6, heu));
+  qtys.clear();
+  qtys.push_back(3);
+  qtys.push_back(1);
+  qtys.push_back(4);
+  mats = WithdrawTrades(buf, qtys);
+  ASSERT_EQ(3, mats.size());
+  EXPECT_DOUBLE_EQ(3, mats[0]->quantity());
+  EXPECT_EQ(leu, mats[0]->comp());
+  EXPECT_DOUBLE_EQ(1, mats[1]->quantity());
+  EXPECT_EQ(leu, mats[1]->comp());
+  EXPECT_DOUBLE_EQ(4, mats[2]->quantity());
+  EXPECT_EQ(heu, mats[2]->comp());
+  EXPECT_DOUBLE_EQ(2, buf.quantity());
+
+  // trades beyond the buffer contents are an error
+  EXPECT_THROW(WithdrawTrades(buf, std::vector<double>(1, 3)),
+               cyclus::ValueError);
+
+  EXPECT_TRUE(WithdrawTrades(buf, std::vector<double>()).empty());
+}
+
+}  // namespace cycamore
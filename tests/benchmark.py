@@ -0,0 +1,356 @@
+#!/usr/bin/env python
+"""Fleet-scale benchmark scenarios for the cycamore archetypes.
+
+This module generates parametrized scenarios with N reactors, M supporting
+facilities of each kind (enrichment, fuel fabrication, separations, ...) and
+T time steps for a handful of archetype mixes and runs them through cyclus,
+recording the wall time, peak resident memory and output database size of
+each run.  It is not part of the regression suite; it is meant to be run by
+hand before and after a change to catch performance regressions:
+
+.. code-block:: bash
+
+  $ python benchmark.py --mix once_through recycle --reactors 10 100 \\
+        --facilities 2 --duration 120 --out before.csv
+
+Use ``--gen-only`` to only write the input files, and ``--profile`` to set
+``profile_phases`` on every facility, which adds the per-agent
+``AgentPhaseTimes`` table to the output databases.
+"""
+from __future__ import print_function
+
+import argparse
+import csv
+import itertools
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+MIXES = ("once_through", "recycle", "storage")
+
+HEADER = """<simulation>
+  <control>
+    <duration>{duration}</duration>
+    <startmonth>1</startmonth>
+    <startyear>2000</startyear>
+  </control>
+
+  <archetypes>
+    <spec><lib>agents</lib><name>NullRegion</name></spec>
+    <spec><lib>agents</lib><name>NullInst</name></spec>
+{specs}  </archetypes>
+"""
+
+SPEC = "    <spec><lib>cycamore</lib><name>{0}</name></spec>\n"
+
+FACILITY = """
+  <facility>
+    <name>{name}</name>
+    <config>
+      <{arche}>
+{body}      </{arche}>
+    </config>
+  </facility>
+"""
+
+REGION = """
+  <region>
+    <name>SingleRegion</name>
+    <config><NullRegion/></config>
+    <institution>
+      <name>SingleInstitution</name>
+      <initialfacilitylist>
+{entries}      </initialfacilitylist>
+      <config><NullInst/></config>
+    </institution>
+  </region>
+"""
+
+ENTRY = """        <entry>
+          <prototype>{0}</prototype>
+          <number>{1}</number>
+        </entry>
+"""
+
+RECIPES = """
+  <recipe>
+    <name>natl_u</name>
+    <basis>mass</basis>
+    <nuclide> <id>U235</id> <comp>0.711</comp> </nuclide>
+    <nuclide> <id>U238</id> <comp>99.289</comp> </nuclide>
+  </recipe>
+
+  <recipe>
+    <name>depleted_u</name>
+    <basis>mass</basis>
+    <nuclide> <id>U235</id> <comp>0.003</comp> </nuclide>
+    <nuclide> <id>U238</id> <comp>0.997</comp> </nuclide>
+  </recipe>
+
+  <recipe>
+    <name>fresh_uox</name>
+    <basis>mass</basis>
+    <nuclide> <id>U235</id> <comp>0.04</comp> </nuclide>
+    <nuclide> <id>U238</id> <comp>0.96</comp> </nuclide>
+  </recipe>
+
+  <recipe>
+    <name>fresh_mox</name>
+    <basis>mass</basis>
+    <nuclide> <id>U235</id>  <comp>0.0027381</comp> </nuclide>
+    <nuclide> <id>U238</id>  <comp>0.9099619</comp> </nuclide>
+    <nuclide> <id>Pu238</id> <comp>0.001746</comp> </nuclide>
+    <nuclide> <id>Pu239</id> <comp>0.045396</comp> </nuclide>
+    <nuclide> <id>Pu240</id> <comp>0.020952</comp> </nuclide>
+    <nuclide> <id>Pu241</id> <comp>0.013095</comp> </nuclide>
+    <nuclide> <id>Pu242</id> <comp>0.005238</comp> </nuclide>
+  </recipe>
+
+  <recipe>
+    <name>spent_mox</name>
+    <basis>mass</basis>
+    <nuclide> <id>U235</id>  <comp>0.0017381</comp> </nuclide>
+    <nuclide> <id>U238</id>  <comp>0.90</comp> </nuclide>
+    <nuclide> <id>Pu238</id> <comp>0.001746</comp> </nuclide>
+    <nuclide> <id>Pu239</id> <comp>0.0134</comp> </nuclide>
+    <nuclide> <id>Pu240</id> <comp>0.020952</comp> </nuclide>
+    <nuclide> <id>Pu241</id> <comp>0.013095</comp> </nuclide>
+    <nuclide> <id>Pu242</id> <comp>0.005238</comp> </nuclide>
+  </recipe>
+
+  <recipe>
+    <name>spent_uox</name>
+    <basis>mass</basis>
+    <nuclide> <id>U235</id>  <comp>156.729</comp> </nuclide>
+    <nuclide> <id>U236</id>  <comp>102.103</comp> </nuclide>
+    <nuclide> <id>U238</id>  <comp>18280.324</comp> </nuclide>
+    <nuclide> <id>Np237</id> <comp>13.656</comp> </nuclide>
+    <nuclide> <id>Pu238</id> <comp>5.043</comp> </nuclide>
+    <nuclide> <id>Pu239</id> <comp>106.343</comp> </nuclide>
+    <nuclide> <id>Pu240</id> <comp>41.357</comp> </nuclide>
+    <nuclide> <id>Pu241</id> <comp>36.477</comp> </nuclide>
+    <nuclide> <id>Pu242</id> <comp>15.387</comp> </nuclide>
+    <nuclide> <id>Am241</id> <comp>1.234</comp> </nuclide>
+    <nuclide> <id>Am243</id> <comp>3.607</comp> </nuclide>
+    <nuclide> <id>Cm244</id> <comp>0.431</comp> </nuclide>
+    <nuclide> <id>Cm245</id> <comp>1.263</comp> </nuclide>
+  </recipe>
+</simulation>
+"""
+
+
+def source(out):
+    return ("        <outcommod>{0}</outcommod>\n"
+            "        <outrecipe>{0}</outrecipe>\n".format(out))
+
+
+def sink(commods):
+    vals = "".join("<val>{0}</val>".format(c) for c in commods)
+    return ("        <in_commods>{0}</in_commods>\n"
+            "        <capacity>1e100</capacity>\n".format(vals))
+
+
+def enrichment(product):
+    return ("        <feed_commod>natl_u</feed_commod>\n"
+            "        <feed_recipe>natl_u</feed_recipe>\n"
+            "        <product_commod>{0}</product_commod>\n"
+            "        <tails_commod>waste</tails_commod>\n"
+            "        <tails_assay>0.003</tails_assay>\n"
+            "        <max_feed_inventory>1e6</max_feed_inventory>\n"
+            "        <swu_capacity>1e100</swu_capacity>\n".format(product))
+
+
+def reactor(recycle):
+    if recycle:
+        fuel = ("        <fuel_inrecipes>  <val>fresh_uox</val>"
+                "  <val>fresh_mox</val> </fuel_inrecipes>\n"
+                "        <fuel_outrecipes> <val>spent_uox</val>"
+                "  <val>spent_mox</val> </fuel_outrecipes>\n"
+                "        <fuel_incommods>  <val>uox</val>"
+                "        <val>mox</val>       </fuel_incommods>\n"
+                "        <fuel_outcommods> <val>spent_uox</val>"
+                "  <val>waste</val>     </fuel_outcommods>\n"
+                "        <fuel_prefs>      <val>1.0</val>"
+                "        <val>2.0</val>       </fuel_prefs>\n")
+    else:
+        fuel = ("        <fuel_inrecipes>  <val>fresh_uox</val> "
+                "</fuel_inrecipes>\n"
+                "        <fuel_outrecipes> <val>spent_uox</val> "
+                "</fuel_outrecipes>\n"
+                "        <fuel_incommods>  <val>uox</val>       "
+                "</fuel_incommods>\n"
+                "        <fuel_outcommods> <val>spent_uox</val> "
+                "</fuel_outcommods>\n")
+    return fuel + ("        <cycle_time>17</cycle_time>\n"
+                   "        <refuel_time>2</refuel_time>\n"
+                   "        <assem_size>30000</assem_size>\n"
+                   "        <n_assem_core>3</n_assem_core>\n"
+                   "        <n_assem_batch>1</n_assem_batch>\n")
+
+
+def separations():
+    return ("        <streams>\n"
+            "          <item>\n"
+            "            <commod>sep_stream</commod>\n"
+            "            <info>\n"
+            "              <buf_size>1e100</buf_size>\n"
+            "              <efficiencies>\n"
+            "                <item><comp>Pu</comp> <eff>.99</eff></item>\n"
+            "              </efficiencies>\n"
+            "            </info>\n"
+            "          </item>\n"
+            "        </streams>\n"
+            "        <leftover_commod>waste</leftover_commod>\n"
+            "        <throughput>1e100</throughput>\n"
+            "        <feedbuf_size>1e100</feedbuf_size>\n"
+            "        <feed_commods> <val>spent_uox</val> </feed_commods>\n")
+
+
+def fuel_fab():
+    return ("        <fill_commods> <val>depleted_u</val> </fill_commods>\n"
+            "        <fill_recipe>depleted_u</fill_recipe>\n"
+            "        <fill_size>1e6</fill_size>\n"
+            "        <fiss_commods> <val>sep_stream</val> </fiss_commods>\n"
+            "        <fiss_size>1e6</fiss_size>\n"
+            "        <spectrum>thermal</spectrum>\n"
+            "        <outcommod>mox</outcommod>\n"
+            "        <throughput>1e6</throughput>\n")
+
+
+def storage():
+    return ("        <in_commods> <val>spent_uox</val> </in_commods>\n"
+            "        <out_commods> <val>waste</val> </out_commods>\n"
+            "        <residence_time>12</residence_time>\n")
+
+
+def scenario(mix, reactors, facilities, duration, profile=False):
+    """Returns the cyclus input file text for a fleet of the given mix with the
+    given number of reactors, number of each supporting facility and
+    duration.  With profile, every facility records its phase profile.
+    """
+    if mix not in MIXES:
+        raise ValueError("unknown mix {0!r}, expected one of {1}".format(
+            mix, ", ".join(MIXES)))
+    recycle = mix == "recycle"
+    protos = [
+        ("natl_src", "Source", source("natl_u"), facilities),
+        ("enrichment", "Enrichment", enrichment("uox"), facilities),
+        ("reactor", "Reactor", reactor(recycle), reactors),
+    ]
+    if recycle:
+        protos += [
+            ("depleted_src", "Source", source("depleted_u"), facilities),
+            ("separations", "Separations", separations(), facilities),
+            ("fuelfab", "FuelFab", fuel_fab(), facilities),
+            ("repo", "Sink", sink(["waste"]), 1),
+        ]
+    elif mix == "storage":
+        protos += [
+            ("storage", "Storage", storage(), facilities),
+            ("repo", "Sink", sink(["waste"]), 1),
+        ]
+    else:
+        protos += [("repo", "Sink", sink(["waste", "spent_uox"]), 1)]
+
+    arches = []
+    for _, arche, _, _ in protos:
+        if arche not in arches:
+            arches.append(arche)
+    s = HEADER.format(duration=duration,
+                      specs="".join(SPEC.format(a) for a in arches))
+    for name, arche, body, _ in protos:
+        if profile:
+            body += "        <profile_phases>1</profile_phases>\n"
+        s += FACILITY.format(name=name, arche=arche, body=body)
+    s += REGION.format(entries="".join(ENTRY.format(name, n)
+                                       for name, _, _, n in protos))
+    s += RECIPES
+    return s
+
+
+def write_scenario(path, mix, reactors, facilities, duration, profile=False):
+    with open(path, "w") as f:
+        f.write(scenario(mix, reactors, facilities, duration, profile))
+    return path
+
+
+def run(cyclus, in_path, out_path):
+    """Runs cyclus on in_path and returns (wall seconds, peak RSS in kB,
+    output size in bytes, return code).
+    """
+    if os.path.exists(out_path):
+        os.remove(out_path)
+    with open(os.devnull, "w") as devnull:
+        start = time.time()
+        p = subprocess.Popen([cyclus, "-o", out_path, "--input-file", in_path],
+                             stdout=devnull, stderr=devnull)
+        # wait4 gives the resource usage of this child alone
+        _, status, usage = os.wait4(p.pid, 0)
+        wall = time.time() - start
+    rtn = os.WEXITSTATUS(status) if os.WIFEXITED(status) else -1
+    # ru_maxrss is in kB on Linux but in bytes on macOS
+    rss = usage.ru_maxrss
+    if sys.platform == "darwin":
+        rss //= 1024
+    size = os.path.getsize(out_path) if os.path.exists(out_path) else 0
+    return wall, rss, size, rtn
+
+
+def main(args=None):
+    p = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    p.add_argument("--mix", nargs="+", default=["once_through"],
+                   choices=MIXES, help="archetype mixes to run")
+    p.add_argument("--reactors", nargs="+", type=int, default=[10],
+                   help="number of reactors in each fleet")
+    p.add_argument("--facilities", nargs="+", type=int, default=[1],
+                   help="number of each supporting facility")
+    p.add_argument("--duration", nargs="+", type=int, default=[120],
+                   help="simulation durations in time steps")
+    p.add_argument("--repeat", type=int, default=1,
+                   help="number of runs of each scenario")
+    p.add_argument("--cyclus", default="cyclus", help="cyclus executable")
+    p.add_argument("--ext", default=".sqlite", choices=[".sqlite", ".h5"],
+                   help="output database format")
+    p.add_argument("--dir", default=None,
+                   help="directory for inputs and outputs (default: a new "
+                        "temporary directory)")
+    p.add_argument("--out", default=None,
+                   help="CSV file for the results (default: stdout)")
+    p.add_argument("--gen-only", action="store_true",
+                   help="only write the input files")
+    p.add_argument("--profile", action="store_true",
+                   help="record AgentPhaseTimes in the outputs")
+    ns = p.parse_args(args)
+
+    d = ns.dir or tempfile.mkdtemp(prefix="cycamore-bench-")
+    if not os.path.isdir(d):
+        os.makedirs(d)
+
+    f = open(ns.out, "w") if ns.out else sys.stdout
+    w = csv.writer(f)
+    if not ns.gen_only:
+        w.writerow(["mix", "reactors", "facilities", "duration", "run",
+                    "wall_s", "peak_rss_kb", "db_bytes", "returncode"])
+    failed = False
+    for mix, n, m, t in itertools.product(ns.mix, ns.reactors,
+                                          ns.facilities, ns.duration):
+        base = os.path.join(d, "{0}_r{1}_f{2}_t{3}".format(mix, n, m, t))
+        in_path = write_scenario(base + ".xml", mix, n, m, t, ns.profile)
+        if ns.gen_only:
+            print(in_path)
+            continue
+        for i in range(ns.repeat):
+            wall, rss, size, rtn = run(ns.cyclus, in_path, base + ns.ext)
+            w.writerow([mix, n, m, t, i, "{0:.3f}".format(wall), rss, size,
+                        rtn])
+            f.flush()
+            failed = failed or rtn != 0
+    if ns.out:
+        f.close()
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
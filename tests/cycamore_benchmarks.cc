@@ -0,0 +1,299 @@
+// Microbenchmarks for the cycamore archetype hot paths.  This is built as the
+// separate cycamore_benchmarks target when BUILD_BENCHMARKS is on; it is not
+// part of the unit tests.  Compositions are sized with the benchmark argument
+// (number of nuclides) to cover everything from fresh uranium to full spent
+// fuel vectors.
+#include <map>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "cyclus.h"
+#include "test_context.h"
+
+#include "enrichment.h"
+#include "fuel_fab.h"
+#include "mixer.h"
+#include "reactor.h"
+#include "separations.h"
+#include "storage.h"
+
+using cyclus::CompMap;
+using cyclus::Composition;
+using cyclus::Material;
+using cyclus::toolkit::MatVec;
+
+namespace {
+
+// Returns a composition with n actinide nuclides (at least uranium 235 and
+// 238) with slowly decreasing masses, shaped like a spent fuel vector.
+Composition::Ptr ActinideComp(int n, double shift = 0) {
+  CompMap m;
+  m[922350000] = 4 + shift;
+  m[922380000] = 950;
+  for (int i = 2; i < n; ++i) {
+    int z = 90 + i % 8;
+    int a = 228 + i / 8 + (z - 90);
+    m[z * 10000000 + a * 10000] += 10.0 / i;
+  }
+  return Composition::CreateFromMass(m);
+}
+
+Composition::Ptr NatU() {
+  CompMap m;
+  m[922350000] = 0.711;
+  m[922380000] = 99.289;
+  return Composition::CreateFromMass(m);
+}
+
+}  // namespace
+
+namespace cycamore {
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+static void BM_CosiWeightCached(benchmark::State& state) {
+  Composition::Ptr c = ActinideComp(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(CosiWeight(c, "thermal"));
+  }
+}
+BENCHMARK(BM_CosiWeightCached)->Arg(2)->Arg(13)->Arg(200);
+
+static void BM_CosiWeightUncached(benchmark::State& state) {
+  int i = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    Composition::Ptr c = ActinideComp(state.range(0), 1e-6 * ++i);
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(CosiWeight(c, "thermal"));
+  }
+}
+BENCHMARK(BM_CosiWeightUncached)->Arg(2)->Arg(13)->Arg(200);
+
+static void BM_AtomToMassFrac(benchmark::State& state) {
+  Composition::Ptr c1 = ActinideComp(state.range(0));
+  Composition::Ptr c2 = NatU();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(AtomToMassFrac(0.1, c1, c2));
+  }
+}
+BENCHMARK(BM_AtomToMassFrac)->Arg(2)->Arg(13)->Arg(200);
+
+static void BM_HighFrac(benchmark::State& state) {
+  double w = 0;
+  for (auto _ : state) {
+    w += 1e-9;
+    benchmark::DoNotOptimize(HighFrac(0.5, 1.0 + w, 1.5));
+  }
+}
+BENCHMARK(BM_HighFrac);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+static void BM_SepMaterial(benchmark::State& state) {
+  Material::Ptr mat = Material::CreateUntracked(100,
+                                                ActinideComp(state.range(0)));
+  std::map<int, double> effs;
+  effs[pyne::nucname::id("Pu")] = 0.99;
+  effs[pyne::nucname::id("U235")] = 0.5;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(SepMaterial(effs, mat));
+  }
+}
+BENCHMARK(BM_SepMaterial)->Arg(2)->Arg(13)->Arg(200);
+
+static void BM_SepMatrixSplit(benchmark::State& state) {
+  Material::Ptr mat = Material::CreateUntracked(100,
+                                                ActinideComp(state.range(0)));
+  std::vector<std::map<int, double> > streams(2);
+  streams[0][pyne::nucname::id("Pu")] = 0.99;
+  streams[1][pyne::nucname::id("U")] = 0.98;
+  SepMatrix sep(streams);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(sep.Split(mat));
+  }
+}
+BENCHMARK(BM_SepMatrixSplit)->Arg(2)->Arg(13)->Arg(200);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+/// Sets up an Enrichment with a large natural uranium feed inventory.
+class EnrichmentBench {
+ public:
+  EnrichmentBench() : e_(new Enrichment(tc_.get())) {
+    tc_.get()->AddRecipe("natu", NatU());
+    e_->feed_recipe = "natu";
+    e_->feed_commod = "natu";
+    e_->product_commod = "leu";
+    e_->tails_commod = "tails";
+    e_->tails_assay = 0.003;
+    e_->max_enrich = 1;
+    e_->SetMaxInventorySize(1e300);
+    e_->SwuCapacity(1e300);
+    e_->AddMat_(Material::CreateUntracked(1e12, NatU()));
+  }
+
+  ~EnrichmentBench() { delete e_; }
+
+  Material::Ptr Enrich(Material::Ptr mat, double qty) {
+    return e_->Enrich_(mat, qty);
+  }
+
+ private:
+  cyclus::TestContext tc_;
+  Enrichment* e_;
+};
+
+static void BM_EnrichmentEnrich(benchmark::State& state) {
+  EnrichmentBench bench;
+  CompMap m;
+  m[922350000] = 0.04;
+  m[922380000] = 0.96;
+  Material::Ptr target = Material::CreateUntracked(
+      1, Composition::CreateFromMass(m));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bench.Enrich(target, 1));
+  }
+}
+BENCHMARK(BM_EnrichmentEnrich);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+/// Sets up a Reactor whose spent fuel buffer holds n assemblies split over
+/// two output commodities.
+class ReactorBench {
+ public:
+  explicit ReactorBench(int n) : r_(new Reactor(tc_.get())) {
+    r_->fuel_incommods.push_back("uox");
+    r_->fuel_incommods.push_back("mox");
+    r_->fuel_outcommods.push_back("spent_uox");
+    r_->fuel_outcommods.push_back("spent_mox");
+    MatVec mats;
+    for (int i = 0; i < n; ++i) {
+      Material::Ptr m = Material::CreateUntracked(30000, ActinideComp(13));
+      r_->index_res(m, i % 2 == 0 ? "uox" : "mox");
+      mats.push_back(m);
+    }
+    r_->PushToSpent(mats);
+  }
+
+  ~ReactorBench() { delete r_; }
+
+  const std::map<std::string, MatVec>& PeekSpent() { return r_->PeekSpent(); }
+
+  /// Forces the next PeekSpent to rebuild its index from the buffer.
+  void Invalidate() { r_->n_spent_indexed_ = -1; }
+
+ private:
+  cyclus::TestContext tc_;
+  Reactor* r_;
+};
+
+static void BM_ReactorPeekSpent(benchmark::State& state) {
+  ReactorBench bench(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(bench.PeekSpent());
+  }
+}
+BENCHMARK(BM_ReactorPeekSpent)->Arg(3)->Arg(100)->Arg(10000);
+
+static void BM_ReactorPeekSpentRebuild(benchmark::State& state) {
+  ReactorBench bench(state.range(0));
+  for (auto _ : state) {
+    bench.Invalidate();
+    benchmark::DoNotOptimize(bench.PeekSpent());
+  }
+}
+BENCHMARK(BM_ReactorPeekSpentRebuild)->Arg(3)->Arg(100)->Arg(10000);
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+/// Sets up a Mixer blending three streams in equal parts.
+class MixerBench {
+ public:
+  MixerBench() : m_(new Mixer(tc_.get())) {
+    m_->out_commod = "mixed";
+    m_->throughput = 1e299;
+    m_->output.capacity(1e299);
+    for (int i = 0; i < 3; ++i) {
+      std::map<std::string, double> commods;
+      commods["in_" + std::to_string(i)] = 1;
+      m_->streams_.push_back(
+          std::make_pair(std::make_pair(1.0 / 3, 1e299), commods));
+    }
+    m_->EnterNotify();
+  }
+
+  ~MixerBench() { delete m_; }
+
+  /// Refills each stream with n materials and empties the output.
+  void Fill(int n) {
+    m_->output.PopN(m_->output.count());
+    for (int i = 0; i < m_->mixing_ratios.size(); ++i) {
+      for (int j = 0; j < n; ++j) {
+        m_->streambufs[i].Push(
+            Material::CreateUntracked(10, ActinideComp(13)));
+      }
+    }
+  }
+
+  void Tick() { m_->Tick(); }
+
+ private:
+  cyclus::TestContext tc_;
+  Mixer* m_;
+};
+
+static void BM_MixerTick(benchmark::State& state) {
+  MixerBench bench;
+  for (auto _ : state) {
+    state.PauseTiming();
+    bench.Fill(state.range(0));
+    state.ResumeTiming();
+    bench.Tick();
+  }
+}
+BENCHMARK(BM_MixerTick)->Arg(1)->Arg(100);
+
+}  // namespace cycamore
+
+namespace storage {
+
+// - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+/// Sets up a Storage with n equal materials ready to move to stocks.
+class StorageBench {
+ public:
+  StorageBench() : s_(new Storage(tc_.get())) {
+    s_->discrete_handling = false;
+  }
+
+  ~StorageBench() { delete s_; }
+
+  /// Returns stocks to ready and tops ready up to n materials.
+  void Fill(int n) {
+    s_->stocks.PopN(s_->stocks.count());
+    while (s_->ready.count() < n) {
+      s_->ready.Push(Material::CreateUntracked(10, ActinideComp(13)));
+    }
+  }
+
+  void ProcessMat(double cap) { s_->ProcessMat_(cap); }
+
+ private:
+  cyclus::TestContext tc_;
+  Storage* s_;
+};
+
+static void BM_StorageProcessMat(benchmark::State& state) {
+  StorageBench bench;
+  int n = state.range(0);
+  for (auto _ : state) {
+    state.PauseTiming();
+    bench.Fill(n);
+    state.ResumeTiming();
+    // moves a bit more than half of the ready materials, splitting one
+    bench.ProcessMat(10 * n / 2 + 5);
+  }
+}
+BENCHMARK(BM_StorageProcessMat)->Arg(1)->Arg(100)->Arg(10000);
+
+}  // namespace storage
+
+BENCHMARK_MAIN();